@@ -16,6 +16,52 @@ bool check_file_exists(const char* path)
 	return stat(path,&tf)==0;
 }
 
+/**
+ *	unmap file memory when the mapping goes out of scope
+ */
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+/**
+ *	map file into memory
+ *	\param path: path to file
+ *	\returns true if the file could be mapped
+ *	NOTE empty files can not be mapped
+ */
+bool MappedFile::open(const char* path)
+{
+	close();
+	s32 __File = ::open(path,O_RDONLY);
+	if (__File<0) return false;
+	struct stat __Stat;
+	if (fstat(__File,&__Stat)||!__Stat.st_size)
+	{
+		::close(__File);
+		return false;
+	}
+
+	// the mapping outlives the descriptor
+	void* __Mapping = mmap(nullptr,__Stat.st_size,PROT_READ,MAP_PRIVATE,__File,0);
+	::close(__File);
+	if (__Mapping==MAP_FAILED) return false;
+	data = (u8*)__Mapping;
+	size = __Stat.st_size;
+	return true;
+}
+
+/**
+ *	unmap file memory
+ */
+void MappedFile::close()
+{
+	if (data==nullptr) return;
+	munmap(data,size);
+	data = nullptr;
+	size = 0;
+}
+
 /**
  *	split line into words
  *	\param words: output vector for words
@@ -28,6 +74,31 @@ void split_words(vector<string>& words,string& line)
 	while (stream>>word) words.push_back(word);
 }
 
+/**
+ *	decode utf-8 encoded codepoint
+ *	\param str: utf-8 encoded string
+ *	\param i: byte index of the codepoint, advanced to the following codepoint
+ *	\returns unicode codepoint, malformed sequences decode to U+FFFD
+ */
+u32 decode_utf8(string& str,u32& i)
+{
+	u8 __Lead = str[i++];
+	u8 __Length = (__Lead<0x80) ? 0 : ((__Lead>>5)==0x6) ? 1 : ((__Lead>>4)==0xe) ? 2 : ((__Lead>>3)==0x1e) ? 3 : 4;
+	if (!__Length) return __Lead;
+	if (__Length>3||i+__Length>str.size()) return 0xfffd;
+
+	// continuation bytes hold 6 bits each, the lead byte the remaining high bits
+	u32 __Codepoint = __Lead&(0x3f>>__Length);
+	for (u8 j=0;j<__Length;j++)
+	{
+		u8 __Continuation = str[i+j];
+		if ((__Continuation&0xc0)!=0x80) return 0xfffd;
+		__Codepoint = (__Codepoint<<6)|(__Continuation&0x3f);
+	}
+	i += __Length;
+	return __Codepoint;
+}
+
 /**
  *	calculate halfway vector in-between the two given vectors
  *	\param a: first vector
@@ -279,6 +350,88 @@ void Transform3D::rotate(vec3 r,vec3 a)
 	transform(position-a,__ScaleFactor,r);
 }
 
+/**
+ *	fit axis aligned bounding box & bounding sphere around vertices
+ *	\param verts: vertex memory
+ *	\param vsize: amount of vertices
+ *	\param ssize: vertex width in bytes
+ *	NOTE vertex position is expected to be the leading vec3 of each vertex
+ */
+void BoundingVolume::fit(void* verts,size_t vsize,size_t ssize)
+{
+	if (!vsize) return;
+	u8* __Vertices = (u8*)verts;
+
+	// axis aligned bounds
+	memcpy(&minimum,__Vertices,sizeof(vec3));
+	maximum = minimum;
+	for (size_t i=1;i<vsize;i++)
+	{
+		vec3 __Position;
+		memcpy(&__Position,__Vertices+i*ssize,sizeof(vec3));
+		minimum = glm::min(minimum,__Position);
+		maximum = glm::max(maximum,__Position);
+	}
+
+	// sphere around box center, tighter than the box diagonal for most meshes
+	center = (minimum+maximum)*.5f;
+	radius = .0f;
+	for (size_t i=0;i<vsize;i++)
+	{
+		vec3 __Position;
+		memcpy(&__Position,__Vertices+i*ssize,sizeof(vec3));
+		radius = glm::max(radius,glm::length(__Position-center));
+	}
+}
+
+/**
+ *	remove all spheres, keeping memory for the next batch
+ */
+void BoundingSpheres::clear()
+{
+	x.clear();
+	y.clear();
+	z.clear();
+	r.clear();
+}
+
+/**
+ *	add sphere to batch
+ *	\param center: world space sphere center
+ *	\param radius: world space sphere radius
+ */
+void BoundingSpheres::push(vec3 center,f32 radius)
+{
+	x.push_back(center.x);
+	y.push_back(center.y);
+	z.push_back(center.z);
+	r.push_back(radius);
+}
+
+/**
+ *	test spheres against frustum
+ *	\param spheres: batch of world space spheres
+ *	\param visible: output array of sphere count, 1 if sphere intersects the frustum, 0 otherwise
+ *	NOTE branchless plane-major loops, so the compiler vectorizes them over the sphere components
+ */
+void Frustum::cull(BoundingSpheres& spheres,u8* visible)
+{
+	size_t __Count = spheres.size();
+	f32* __X = spheres.x.data();
+	f32* __Y = spheres.y.data();
+	f32* __Z = spheres.z.data();
+	f32* __R = spheres.r.data();
+	for (size_t i=0;i<__Count;i++) visible[i] = 1;
+	for (u8 p=0;p<6;p++)
+	{
+		f32 __NX = nx[p];
+		f32 __NY = ny[p];
+		f32 __NZ = nz[p];
+		f32 __D = d[p];
+		for (size_t i=0;i<__Count;i++) visible[i] &= (__NX*__X[i]+__NY*__Y[i]+__NZ*__Z[i]+__D>-__R[i]);
+	}
+}
+
 
 // ----------------------------------------------------------------------------------------------------
 // Coordinate System
@@ -384,6 +537,31 @@ void Camera3D::orthographics()
 	proj = glm::ortho(-hwidth,hwidth,-hheight,hheight,near,far);
 }
 
+/**
+ *	extract view frustum planes from current camera matrices
+ *	\returns normalized frustum planes: left, right, bottom, top, near, far
+ */
+Frustum Camera3D::frustum()
+{
+	Frustum __Frustum;
+	mat4 __Projection = proj*view;
+	for (u8 i=0;i<6;i++)
+	{
+		// combine last matrix row with the row of the plane axis
+		u8 __Axis = i>>1;
+		f32 __Sign = (i&1) ? -1.f : 1.f;
+		vec4 __Plane = vec4(__Projection[0][3],__Projection[1][3],__Projection[2][3],__Projection[3][3])
+				+__Sign*vec4(__Projection[0][__Axis],__Projection[1][__Axis],__Projection[2][__Axis],
+							 __Projection[3][__Axis]);
+		__Plane /= glm::length(vec3(__Plane));
+		__Frustum.nx[i] = __Plane.x;
+		__Frustum.ny[i] = __Plane.y;
+		__Frustum.nz[i] = __Plane.z;
+		__Frustum.d[i] = __Plane.w;
+	}
+	return __Frustum;
+}
+
 /**
  *	set camera roll
  *	\param r: camera roll in degrees
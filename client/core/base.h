@@ -15,6 +15,9 @@
 
 // basics
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <iostream>
 #include <fstream>
 #include <string>
@@ -27,6 +30,12 @@
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <functional>
+#include <memory>
+#include <atomic>
+#include <algorithm>
+#include <charconv>
+#include <cinttypes>
 
 // ogl
 #include <GL/glew.h>
@@ -39,6 +48,7 @@
 #include <glm/gtx/quaternion.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/packing.hpp>
 
 // texture
 #ifndef STBI_INCLUDE_STB_IMAGE_H
@@ -50,6 +60,7 @@
 // font
 #include <ft2build.h>
 #include FT_FREETYPE_H
+#include FT_MODULE_H
 
 
 // ----------------------------------------------------------------------------------------------------
@@ -219,12 +230,42 @@ static inline f64 profiler_average(RuntimeProfilerData* data)
 
 bool check_file_exists(const char* path);
 void split_words(vector<string>& words,string& line);
+u32 decode_utf8(string& str,u32& i);
 inline f64 calculate_delta_time(std::chrono::steady_clock::time_point& t)
 {
 	return (std::chrono::steady_clock::now()-t).count()*MATH_CONVERSION_MS;
 }
 vec3 halfway(vec3 a,vec3 b);
 
+/**
+ *	fnv-1a hash over raw memory, used to intern names and detect content changes without comparison
+ *	\param data: pointer to memory
+ *	\param size: memory width in bytes
+ *	\param seed: (default fnv offset basis) starting hash, to continue hashing over multiple memory ranges
+ *	\returns 64-bit hash
+ */
+inline u64 hash_fnv1a(const void* data,size_t size,u64 seed=0xcbf29ce484222325)
+{
+	const u8* __Bytes = (const u8*)data;
+	for (size_t i=0;i<size;i++) seed = (seed^__Bytes[i])*0x100000001b3;
+	return seed;
+}
+inline u64 hash_fnv1a(const char* str) { return hash_fnv1a(str,strlen(str)); }
+
+// read-only memory mapping of a whole file, pages are loaded by the os on first access
+struct MappedFile
+{
+	~MappedFile();
+
+	// utility
+	bool open(const char* path);
+	void close();
+
+	// data
+	u8* data = nullptr;
+	size_t size = 0;
+};
+
 
 class BitwiseWords
 {
@@ -336,6 +377,48 @@ struct Transform3D
 };
 
 
+struct BoundingVolume
+{
+	// utility
+	void fit(void* verts,size_t vsize,size_t ssize);
+
+	// data
+	vec3 minimum = vec3(.0f);
+	vec3 maximum = vec3(.0f);
+	vec3 center = vec3(.0f);
+	f32 radius = .0f;
+};
+
+
+// world space bounding spheres in structure of arrays layout, to cull multiple spheres per instruction
+struct BoundingSpheres
+{
+	// utility
+	void clear();
+	void push(vec3 center,f32 radius);
+	inline size_t size() { return x.size(); }
+
+	// data
+	vector<f32> x;
+	vector<f32> y;
+	vector<f32> z;
+	vector<f32> r;
+};
+
+
+struct Frustum
+{
+	// utility
+	void cull(BoundingSpheres& spheres,u8* visible);
+
+	// data, normalized planes as nx*x+ny*y+nz*z+d=0 with normals pointing inside
+	f32 nx[6];
+	f32 ny[6];
+	f32 nz[6];
+	f32 d[6];
+};
+
+
 class CoordinateSystem2D
 {
 public:
@@ -362,6 +445,7 @@ public:
 	void force_position();
 	void project();
 	void orthographics();
+	Frustum frustum();
 
 	// camera action
 	void roll(f32 r);
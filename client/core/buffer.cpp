@@ -46,6 +46,15 @@ void VertexBuffer::bind()
 	glBindBuffer(GL_ARRAY_BUFFER,m_VBO);
 }
 
+/**
+ *	bind vertex buffer as element buffer
+ *	NOTE the element buffer binding is part of the active vertex array state
+ */
+void VertexBuffer::bind_elements()
+{
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,m_VBO);
+}
+
 /**
  *	unbind all vertex buffers
  */
@@ -75,6 +84,190 @@ void VertexBuffer::upload_elements(vector<u32> elements)
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER,elements.size()*sizeof(u32),&elements[0],GL_STATIC_DRAW);
 }
 
+/**
+ *	create uniform buffer, holding std140 aligned uniform block memory shared between pipelines
+ */
+UniformBuffer::UniformBuffer()
+{
+	glGenBuffers(1,&m_UBO);
+}
+
+/**
+ *	bind uniform buffer
+ */
+void UniformBuffer::bind()
+{
+	glBindBuffer(GL_UNIFORM_BUFFER,m_UBO);
+}
+
+/**
+ *	allocate uniform block memory and attach buffer to its binding point
+ *	\param data: initial block memory, has to match the std140 layout of the block
+ *	\param size: block width in bytes
+ *	\param binding: uniform block binding point, pipelines map their blocks by name on assembly
+ *	\param memtype: (default GL_DYNAMIC_DRAW) GL_(STREAM+STATIC+DYNAMIC)_(DRAW+READ+COPY)
+ */
+void UniformBuffer::allocate(void* data,size_t size,u32 binding,GLenum memtype)
+{
+	bind();
+	glBufferData(GL_UNIFORM_BUFFER,size,data,memtype);
+	glBindBufferBase(GL_UNIFORM_BUFFER,binding,m_UBO);
+}
+
+/**
+ *	overwrite a range of allocated uniform block memory
+ *	\param data: pointer to range memory
+ *	\param offset: byte offset of range within block
+ *	\param size: range width in bytes
+ *	NOTE uniform buffer has to be bound beforehand
+ */
+void UniformBuffer::upload(void* data,size_t offset,size_t size)
+{
+	glBufferSubData(GL_UNIFORM_BUFFER,offset,size,data);
+}
+
+
+/**
+ *	create buffer & its texture view, memory is allocated by the first upload
+ */
+TextureBuffer::TextureBuffer()
+{
+	glGenBuffers(1,&m_Buffer);
+	glGenTextures(1,&m_Texture);
+}
+
+/**
+ *	bind buffer texture to texture channel
+ *	\param channel: texture channel, the sampler has to be a buffer sampler
+ */
+void TextureBuffer::bind(u8 channel)
+{
+	Texture::set_channel(channel);
+	glBindTexture(GL_TEXTURE_BUFFER,m_Texture);
+}
+
+/**
+ *	replace buffer contents, memory grows to fit & is orphaned otherwise, so pending draws keep their data
+ *	\param data: pointer to buffer contents
+ *	\param size: contents width in bytes
+ *	\param format: sized internal format of the texels, e.g. GL_RGBA32UI
+ */
+void TextureBuffer::upload(void* data,size_t size,GLenum format)
+{
+	glBindBuffer(GL_TEXTURE_BUFFER,m_Buffer);
+	m_Capacity = glm::max(m_Capacity,size);
+	glBufferData(GL_TEXTURE_BUFFER,m_Capacity,nullptr,GL_STREAM_DRAW);
+	glBufferSubData(GL_TEXTURE_BUFFER,0,size,data);
+	glBindTexture(GL_TEXTURE_BUFFER,m_Texture);
+	glTexBuffer(GL_TEXTURE_BUFFER,format,m_Buffer);
+	glBindBuffer(GL_TEXTURE_BUFFER,0);
+}
+
+/**
+ *	test if atlas rectangles overlap
+ *	\param a: first rectangle
+ *	\param b: second rectangle
+ *	\returns true if the rectangles share at least one pixel
+ */
+inline bool _atlas_overlap(AtlasRect& a,AtlasRect& b)
+{
+	return a.x<b.x+b.width&&b.x<a.x+a.width&&a.y<b.y+b.height&&b.y<a.y+a.height;
+}
+
+/**
+ *	test if atlas rectangle contains another
+ *	\param a: outer rectangle
+ *	\param b: inner rectangle
+ *	\returns true if b lies completely within a
+ */
+inline bool _atlas_contains(AtlasRect& a,AtlasRect& b)
+{
+	return b.x>=a.x&&b.y>=a.y&&b.x+b.width<=a.x+a.width&&b.y+b.height<=a.y+a.height;
+}
+
+/**
+ *	create pixel unpack buffers, memory is allocated by the first staged upload
+ */
+PixelUploadRing::PixelUploadRing()
+{
+	glGenBuffers(BUFFER_UPLOAD_RING_SLOTS,m_Buffers);
+}
+
+/**
+ *	allocate staging memory behind the previous uploads of the current buffer, bind it as unpack source & map it
+ *	\param size: size of the staged data in bytes
+ *	\param offset: byte offset of the staging memory within the bound buffer, the texture upload source pointer
+ *	\returns writable staging memory, nullptr while the gpu is still reading the next buffer of the ring
+ *	NOTE buffers grow to fit larger uploads & shrink back to BUFFER_UPLOAD_SLOT_SIZE afterwards
+ */
+u8* PixelUploadRing::map(size_t size,size_t& offset)
+{
+	// full buffers are fenced & the ring advances
+	offset = (m_Cursor+BUFFER_UPLOAD_ALIGNMENT-1)&~(BUFFER_UPLOAD_ALIGNMENT-1);
+	if (m_Cursor&&offset+size>m_Capacity[m_Slot])
+	{
+		_advance();
+		offset = 0;
+	}
+
+	// a fresh buffer has to be released by the gpu, never wait for it, the caller retries next frame
+	GLsync& p_Fence = m_Fences[m_Slot];
+	if (p_Fence)
+	{
+		if (glClientWaitSync(p_Fence,0,0)==GL_TIMEOUT_EXPIRED) return nullptr;
+		glDeleteSync(p_Fence);
+		p_Fence = 0;
+	}
+
+	// allocate or orphan memory of a fresh buffer
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER,m_Buffers[m_Slot]);
+	size_t& p_Capacity = m_Capacity[m_Slot];
+	if (!m_Cursor&&(size>p_Capacity||(p_Capacity>BUFFER_UPLOAD_SLOT_SIZE&&size<=BUFFER_UPLOAD_SLOT_SIZE)))
+	{
+		p_Capacity = glm::max(size,(size_t)BUFFER_UPLOAD_SLOT_SIZE);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER,p_Capacity,nullptr,GL_STREAM_DRAW);
+	}
+
+	// earlier allocations of the buffer might still be read, the mapped range is disjoint from them
+	u8* __Staging = (u8*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER,offset,size,
+										  GL_MAP_WRITE_BIT|GL_MAP_INVALIDATE_RANGE_BIT|GL_MAP_UNSYNCHRONIZED_BIT);
+	if (__Staging==nullptr)
+	{
+		COMM_ERR("[BUFFER] mapping pixel upload buffer failed");
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER,0);
+		return nullptr;
+	}
+	m_Cursor = offset+size;
+	return __Staging;
+}
+
+/**
+ *	finish writing staged data, texture uploads issued afterwards read from the buffer by byte offset
+ */
+void PixelUploadRing::unmap()
+{
+	glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+}
+
+/**
+ *	unbind the unpack buffer after the texture uploads reading the staged data have been issued
+ *	NOTE the buffer is fenced once it is full, covering all uploads which have been staged in it
+ */
+void PixelUploadRing::release()
+{
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER,0);
+}
+
+/**
+ *	fence the uploads reading the current buffer & continue with the next buffer of the ring
+ */
+void PixelUploadRing::_advance()
+{
+	m_Fences[m_Slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE,0);
+	m_Slot = (m_Slot+1)%BUFFER_UPLOAD_RING_SLOTS;
+	m_Cursor = 0;
+}
+
 
 // ----------------------------------------------------------------------------------------------------
 // Colour Buffers
@@ -82,15 +275,307 @@ void VertexBuffer::upload_elements(vector<u32> elements)
 s32 _texture_format_channels[] = {
 	GL_RGBA,
 	GL_RGBA,
-	GL_RED
+	GL_RED,
+	GL_RGBA
 };
 
+u8 _texture_format_bytes[] = { 4,4,1,4 };
+
 s32 _texture_format_internal[] = {
 	GL_RGBA,
 	GL_SRGB8_ALPHA8,
-	GL_RED
+	GL_RED,
+	GL_RG8
+};
+
+// block compressed formats, for opaque textures & textures with alpha channel
+u32 _texture_format_compressed[][2] = {
+	{ GL_COMPRESSED_RGB_S3TC_DXT1_EXT,GL_COMPRESSED_RGBA_S3TC_DXT5_EXT },
+	{ GL_COMPRESSED_SRGB_S3TC_DXT1_EXT,GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT },
+	{ GL_COMPRESSED_RED_RGTC1,GL_COMPRESSED_RED_RGTC1 },
+	{ GL_COMPRESSED_RG_RGTC2,GL_COMPRESSED_RG_RGTC2 }
 };
 
+u32 _texture_format_base[][2] = {
+	{ GL_RGB,GL_RGBA },
+	{ GL_RGB,GL_RGBA },
+	{ GL_RED,GL_RED },
+	{ GL_RG,GL_RG }
+};
+
+/**
+ *	encode 4x4 block of single channel values as bc4, also used for bc3 alpha & both bc5 channels
+ *	\param block: 8 byte output block
+ *	\param values: 16 channel values in row order
+ */
+inline void _encode_channel_block(u8* block,u8* values)
+{
+	u8 __Min = 255,__Max = 0;
+	for (u8 i=0;i<16;i++)
+	{
+		__Min = glm::min(__Min,values[i]);
+		__Max = glm::max(__Max,values[i]);
+	}
+
+	// endpoints in descending order select the 8 value palette, equal endpoints only ever use index 0
+	block[0] = __Max;
+	block[1] = __Min;
+	u8 __Palette[8] = { __Max,__Min };
+	for (u8 i=1;i<7;i++) __Palette[i+1] = ((7-i)*__Max+i*__Min+3)/7;
+
+	// 3 bit palette indices, packed from the least significant bit upwards
+	u64 __Indices = 0;
+	for (u8 i=0;i<16;i++)
+	{
+		u8 __Nearest = 0;
+		for (u8 j=1;j<8;j++)
+		{
+			if (abs(values[i]-__Palette[j])<abs(values[i]-__Palette[__Nearest])) __Nearest = j;
+		}
+		__Indices |= (u64)__Nearest<<(i*3);
+	}
+	for (u8 i=0;i<6;i++) block[i+2] = __Indices>>(i*8);
+}
+
+/**
+ *	encode 4x4 block of rgba pixels as bc1 colour block, endpoints are fit along the principal colour axis
+ *	\param block: 8 byte output block
+ *	\param pixels: 16 rgba pixels in row order
+ *	NOTE alpha is ignored, the 3 colour mode with transparency is never used
+ */
+inline void _encode_colour_block(u8* block,u8* pixels)
+{
+	vec3 __Colours[16];
+	vec3 __Mean = vec3(0);
+	for (u8 i=0;i<16;i++)
+	{
+		__Colours[i] = vec3(pixels[i*4],pixels[i*4+1],pixels[i*4+2]);
+		__Mean += __Colours[i];
+	}
+	__Mean /= 16.f;
+
+	// covariance of block colours
+	f32 __Covariance[6] = { 0,0,0,0,0,0 };
+	for (u8 i=0;i<16;i++)
+	{
+		vec3 __Delta = __Colours[i]-__Mean;
+		__Covariance[0] += __Delta.x*__Delta.x;
+		__Covariance[1] += __Delta.x*__Delta.y;
+		__Covariance[2] += __Delta.x*__Delta.z;
+		__Covariance[3] += __Delta.y*__Delta.y;
+		__Covariance[4] += __Delta.y*__Delta.z;
+		__Covariance[5] += __Delta.z*__Delta.z;
+	}
+
+	// principal axis by power iteration, uniform blocks keep the luminance diagonal
+	vec3 __Axis = vec3(1);
+	for (u8 i=0;i<8;i++)
+	{
+		vec3 __Next = vec3(__Covariance[0]*__Axis.x+__Covariance[1]*__Axis.y+__Covariance[2]*__Axis.z,
+						   __Covariance[1]*__Axis.x+__Covariance[3]*__Axis.y+__Covariance[4]*__Axis.z,
+						   __Covariance[2]*__Axis.x+__Covariance[4]*__Axis.y+__Covariance[5]*__Axis.z);
+		f32 __Magnitude = glm::max(glm::max(abs(__Next.x),abs(__Next.y)),abs(__Next.z));
+		if (__Magnitude<.0001f) break;
+		__Axis = __Next/__Magnitude;
+	}
+
+	// project colours onto the axis to find extreme endpoints
+	f32 __Low = .0f,__High = .0f;
+	for (u8 i=0;i<16;i++)
+	{
+		f32 __Projection = glm::dot(__Colours[i]-__Mean,__Axis);
+		__Low = glm::min(__Low,__Projection);
+		__High = glm::max(__High,__Projection);
+	}
+	f32 __AxisLength = glm::dot(__Axis,__Axis);
+	vec3 __Endpoints[2] = {
+		glm::clamp(__Mean+__Axis*(__High/__AxisLength),vec3(0),vec3(255)),
+		glm::clamp(__Mean+__Axis*(__Low/__AxisLength),vec3(0),vec3(255))
+	};
+
+	// quantize endpoints to 5:6:5, the higher endpoint first selects the 4 colour mode
+	u16 __Packed[2];
+	for (u8 i=0;i<2;i++)
+	{
+		__Packed[i] = ((u16)(__Endpoints[i].x*31.f/255.f+.5f)<<11)|((u16)(__Endpoints[i].y*63.f/255.f+.5f)<<5)
+				|(u16)(__Endpoints[i].z*31.f/255.f+.5f);
+	}
+	if (__Packed[0]<__Packed[1]) std::swap(__Packed[0],__Packed[1]);
+	block[0] = __Packed[0];
+	block[1] = __Packed[0]>>8;
+	block[2] = __Packed[1];
+	block[3] = __Packed[1]>>8;
+
+	// palette as the decoder expands it
+	vec3 __Palette[4];
+	for (u8 i=0;i<2;i++)
+	{
+		u8 __Red = __Packed[i]>>11,__Green = (__Packed[i]>>5)&0x3f,__Blue = __Packed[i]&0x1f;
+		__Palette[i] = vec3((__Red<<3)|(__Red>>2),(__Green<<2)|(__Green>>4),(__Blue<<3)|(__Blue>>2));
+	}
+	__Palette[2] = (__Palette[0]*2.f+__Palette[1])/3.f;
+	__Palette[3] = (__Palette[0]+__Palette[1]*2.f)/3.f;
+
+	// 2 bit palette indices, packed from the least significant bit upwards
+	u32 __Indices = 0;
+	for (u8 i=0;i<16&&__Packed[0]!=__Packed[1];i++)
+	{
+		u8 __Nearest = 0;
+		f32 __Distance = glm::dot(__Colours[i]-__Palette[0],__Colours[i]-__Palette[0]);
+		for (u8 j=1;j<4;j++)
+		{
+			f32 __Candidate = glm::dot(__Colours[i]-__Palette[j],__Colours[i]-__Palette[j]);
+			if (__Candidate>=__Distance) continue;
+			__Nearest = j;
+			__Distance = __Candidate;
+		}
+		__Indices |= __Nearest<<(i*2);
+	}
+	for (u8 i=0;i<4;i++) block[i+4] = __Indices>>(i*8);
+}
+
+/**
+ *	encode 4x4 block of rgba pixels into given compressed format
+ *	\param block: output block, 8 bytes for bc1 & bc4, 16 bytes for bc3 & bc5
+ *	\param pixels: 16 rgba pixels in row order
+ *	\param format: compressed internal format
+ */
+inline void _encode_block(u8* block,u8* pixels,u32 format)
+{
+	u8 __Channel[16];
+	switch (format)
+	{
+	case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+	case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+		for (u8 i=0;i<16;i++) __Channel[i] = pixels[i*4+3];
+		_encode_channel_block(block,__Channel);
+		block += 8;
+		[[fallthrough]];
+	case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+	case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+		_encode_colour_block(block,pixels);
+		break;
+	case GL_COMPRESSED_RG_RGTC2:
+		for (u8 i=0;i<16;i++) __Channel[i] = pixels[i*4+1];
+		_encode_channel_block(block+8,__Channel);
+		[[fallthrough]];
+	case GL_COMPRESSED_RED_RGTC1:
+		for (u8 i=0;i<16;i++) __Channel[i] = pixels[i*4];
+		_encode_channel_block(block,__Channel);
+	}
+}
+
+/**
+ *	convert srgb encoded channel value to linear intensity
+ *	\param value: srgb encoded value
+ *	\returns linear intensity between 0 & 1
+ */
+inline f32 _srgb_to_linear(u8 value)
+{
+	static f32 __Linear[256];
+	[[maybe_unused]] static bool __Initialized = []
+	{
+		for (u16 i=0;i<256;i++)
+		{
+			f32 __Value = i/255.f;
+			__Linear[i] = (__Value<=.04045f) ? __Value/12.92f : pow((__Value+.055f)/1.055f,2.4f);
+		}
+		return true;
+	}();
+	return __Linear[value];
+}
+
+/**
+ *	convert linear intensity to srgb encoded channel value
+ *	\param value: linear intensity between 0 & 1
+ *	\returns srgb encoded value
+ */
+inline u8 _linear_to_srgb(f32 value)
+{
+	f32 __Value = (value<=.0031308f) ? value*12.92f : 1.055f*pow(value,1.f/2.4f)-.055f;
+	return glm::clamp(__Value,.0f,1.f)*255.f+.5f;
+}
+
+/**
+ *	downsample rgba pixels to the next mip level with a box filter
+ *	\param dst: output pixels of half the dimensions, rounded down & at least 1
+ *	\param src: input pixels
+ *	\param width: input width
+ *	\param height: input height
+ *	\param format: texture format, srgb is filtered in linear space & normals are renormalized
+ */
+inline void _downsample(u8* dst,u8* src,s32 width,s32 height,TextureFormat format)
+{
+	s32 __Width = glm::max(width>>1,1),__Height = glm::max(height>>1,1);
+	for (s32 y=0;y<__Height;y++)
+	{
+		for (s32 x=0;x<__Width;x++)
+		{
+			// odd edges repeat their last pixel
+			u8* p_Texels[4];
+			for (u8 i=0;i<4;i++)
+			{
+				s32 __X = glm::min(x*2+(i&1),width-1),__Y = glm::min(y*2+(i>>1),height-1);
+				p_Texels[i] = src+(__Y*width+__X)*4;
+			}
+			u8* p_Pixel = dst+(y*__Width+x)*4;
+
+			// filter channels by format
+			switch (format)
+			{
+			case TEXTURE_FORMAT_SRGB:
+				for (u8 c=0;c<3;c++)
+				{
+					f32 __Sum = .0f;
+					for (u8 i=0;i<4;i++) __Sum += _srgb_to_linear(p_Texels[i][c]);
+					p_Pixel[c] = _linear_to_srgb(__Sum*.25f);
+				}
+				p_Pixel[3] = (p_Texels[0][3]+p_Texels[1][3]+p_Texels[2][3]+p_Texels[3][3]+2)>>2;
+				break;
+			case TEXTURE_FORMAT_NORMAL:
+			{
+				vec3 __Normal = vec3(0);
+				for (u8 i=0;i<4;i++) __Normal += vec3(p_Texels[i][0],p_Texels[i][1],p_Texels[i][2])/127.5f-vec3(1);
+				__Normal = (glm::dot(__Normal,__Normal)>.0f) ? glm::normalize(__Normal) : vec3(0,0,1);
+				for (u8 c=0;c<3;c++) p_Pixel[c] = glm::clamp(__Normal[c]*127.5f+128.f,.0f,255.f);
+				p_Pixel[3] = 255;
+				break;
+			}
+			default:
+				for (u8 c=0;c<4;c++) p_Pixel[c] = (p_Texels[0][c]+p_Texels[1][c]+p_Texels[2][c]+p_Texels[3][c]+2)>>2;
+			}
+		}
+	}
+}
+
+/**
+ *	downsample region of a mip level from the next finer level with a box filter
+ *	\param dst: pixels of the coarse level
+ *	\param src: pixels of the finer level
+ *	\param width: finer level width
+ *	\param height: finer level height
+ *	\param rect: downsampled region in coarse level texels
+ *	\param bytes: bytes per pixel, one per channel
+ */
+inline void _downsample_region(u8* dst,u8* src,s32 width,s32 height,AtlasRect& rect,u8 bytes)
+{
+	s32 __Width = glm::max(width>>1,1);
+	for (s32 y=rect.y;y<rect.y+rect.height;y++)
+	{
+		for (s32 x=rect.x;x<rect.x+rect.width;x++)
+		{
+			u8* p_Texels[4];
+			for (u8 i=0;i<4;i++)
+			{
+				s32 __X = glm::min(x*2+(i&1),width-1),__Y = glm::min(y*2+(i>>1),height-1);
+				p_Texels[i] = src+((size_t)__Y*width+__X)*bytes;
+			}
+			u8* p_Pixel = dst+((size_t)y*__Width+x)*bytes;
+			for (u8 c=0;c<bytes;c++) p_Pixel[c] = (p_Texels[0][c]+p_Texels[1][c]+p_Texels[2][c]+p_Texels[3][c]+2)>>2;
+		}
+	}
+}
+
 /**
  *	allocation and setup for texture data load
  *	\param format: (default TEXTURE_FORMAT_RGBA) texture channel format
@@ -112,26 +597,323 @@ void TextureData::load(const char* path)
 }
 
 /**
- *	upload data to gpu
+ *	load texture as block compressed mip chain, from cache or by compressing the decoded source
+ *	\param path: path to texture
+ *	NOTE compressed textures are cached next to the source file, later loads read the cache instead of decoding
+ *	NOTE colour formats fall back to uncompressed data, if the driver lacks s3tc support
+ */
+void TextureData::load_compressed(const char* path)
+{
+	if (!GLEW_EXT_texture_compression_s3tc&&(m_Format==TEXTURE_FORMAT_RGBA||m_Format==TEXTURE_FORMAT_SRGB))
+	{
+		load(path);
+		return;
+	}
+
+	// identify source contents
+	MappedFile __Source;
+	if (!__Source.open(path))
+	{
+		COMM_ERR("texture %s could not be found",path);
+		return;
+	}
+	u64 __SourceHash = hash_fnv1a(__Source.data,__Source.size);
+
+	// compressed texture is still valid
+	string __CachePath = string(path)+BUFFER_TEXTURE_CACHE_EXTENSION;
+	if (_read_cache(__CachePath.c_str(),__SourceHash)) return;
+
+	// decode & compress source
+	stbi_set_flip_vertically_on_load(true);
+	data = stbi_load_from_memory(__Source.data,__Source.size,&width,&height,0,STBI_rgb_alpha);
+	__Source.close();
+	if (data==nullptr)
+	{
+		COMM_ERR("texture %s could not be decoded",path);
+		return;
+	}
+	m_TextureFlag = true;
+	_compress();
+	_write_cache(__CachePath.c_str(),__SourceHash);
+}
+
+/**
+ *	read texture dimensions from file header, to estimate memory before decoding
+ *	\param path: path to texture
+ *	\returns size of decoded texture data in bytes, 0 if the file can not be read
+ */
+size_t TextureData::decoded_size(const char* path)
+{
+	s32 __Width,__Height,__Channels;
+	if (!stbi_info(path,&__Width,&__Height,&__Channels)) return 0;
+	return (size_t)__Width*__Height*STBI_rgb_alpha;
+}
+
+/**
+ *	upload data to gpu, staged through the pixel upload ring
+ *	\param ring: pixel upload ring
+ *	\returns false if the ring had no free buffer, the upload has to be retried later
  *	NOTE has to be uploaded in main thread
  *	NOTE target texture has to be bound before uploading
  */
-void TextureData::gpu_upload()
+bool TextureData::gpu_upload(PixelUploadRing& ring)
 {
+	if (levels.size()) return gpu_upload_levels(ring,0,levels.size()-1);
+	size_t __Size = (size_t)width*height*_texture_format_bytes[m_Format];
+	size_t __Staged;
+	u8* __Staging = ring.map(__Size,__Staged);
+	if (__Staging==nullptr) return false;
+	memcpy(__Staging,data,__Size);
+	ring.unmap();
 	glTexImage2D(GL_TEXTURE_2D,0,_texture_format_internal[m_Format],width,height,0,
-				 _texture_format_channels[m_Format],GL_UNSIGNED_BYTE,data);
+				 _texture_format_channels[m_Format],GL_UNSIGNED_BYTE,(void*)__Staged);
+	ring.release();
 	_free();
+	return true;
 }
 
 /**
- *	upload data as subtexture to atlas on gpu based on saved x & y axis offset
+ *	upload range of levels of the compressed mip chain to gpu, staged through the pixel upload ring
+ *	\param ring: pixel upload ring
+ *	\param finest: finest uploaded mip level, 0 being full resolution
+ *	\param coarsest: coarsest uploaded mip level
+ *	\returns false if the ring had no free buffer, the upload has to be retried later
+ *	NOTE has to be uploaded in main thread
+ *	NOTE target texture has to be bound before uploading
+ *	NOTE data is freed after the full resolution level has been uploaded
+ */
+bool TextureData::gpu_upload_levels(PixelUploadRing& ring,u8 finest,u8 coarsest)
+{
+	// levels are stored consecutively, so the range is staged in one copy
+	u32 __Offset = levels[finest].offset;
+	u32 __Size = levels[coarsest].offset+levels[coarsest].size-__Offset;
+	size_t __Staged;
+	u8* __Staging = ring.map(__Size,__Staged);
+	if (__Staging==nullptr) return false;
+	memcpy(__Staging,data+__Offset,__Size);
+	ring.unmap();
+	for (u8 i=finest;i<=coarsest;i++)
+	{
+		TextureLevel& p_Level = levels[i];
+		glCompressedTexImage2D(GL_TEXTURE_2D,i,m_CompressedFormat,p_Level.width,p_Level.height,0,p_Level.size,
+							   (void*)(__Staged+p_Level.offset-__Offset));
+	}
+	ring.release();
+	if (!finest) _free();
+	return true;
+}
+
+/**
+ *	upload data as subtexture to atlas on gpu based on saved x & y axis offset, staged through the pixel upload ring
+ *	\param ring: pixel upload ring
+ *	\returns false if the ring had no free buffer, the upload has to be retried later
  *	NOTE has to be uploaded in main thread
  *	NOTE target texture has to be bound and allocated before uploading
  */
-void TextureData::gpu_upload_subtexture()
+bool TextureData::gpu_upload_subtexture(PixelUploadRing& ring)
 {
-	glTexSubImage2D(GL_TEXTURE_2D,0,x,y,width,height,_texture_format_channels[m_Format],GL_UNSIGNED_BYTE,data);
+	// empty subtextures, e.g. whitespace glyphs, have nothing to stage
+	size_t __Size = (size_t)width*height*_texture_format_bytes[m_Format];
+	if (!__Size)
+	{
+		_free();
+		return true;
+	}
+	size_t __Staged;
+	u8* __Staging = ring.map(__Size,__Staged);
+	if (__Staging==nullptr) return false;
+	memcpy(__Staging,data,__Size);
+	ring.unmap();
+	glTexSubImage2D(GL_TEXTURE_2D,0,x,y,width,height,_texture_format_channels[m_Format],GL_UNSIGNED_BYTE,
+					(void*)__Staged);
+	ring.release();
+	_free();
+	return true;
+}
+
+/**
+ *	replace decoded rgba data by its block compressed mip chain, down to 1x1
+ *	NOTE colour textures with any transparent pixel are compressed as bc3, opaque ones as bc1
+ */
+void TextureData::_compress()
+{
+	bool __Alpha = false;
+	for (s32 i=0;i<width*height&&!__Alpha;i++) __Alpha = data[i*4+3]<255;
+	m_CompressedFormat = _texture_format_compressed[m_Format][__Alpha];
+	u8 __BlockSize = (m_CompressedFormat==GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+					  ||m_CompressedFormat==GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+					  ||m_CompressedFormat==GL_COMPRESSED_RED_RGTC1) ? 8 : 16;
+
+	// layout of the full mip chain
+	u32 __Size = 0;
+	s32 __Width = width,__Height = height;
+	while (true)
+	{
+		u32 __LevelSize = ((__Width+3)>>2)*((__Height+3)>>2)*__BlockSize;
+		levels.push_back({ __Size,__LevelSize,__Width,__Height });
+		__Size += __LevelSize;
+		if (__Width==1&&__Height==1) break;
+		__Width = glm::max(__Width>>1,1);
+		__Height = glm::max(__Height>>1,1);
+	}
+	u8* __Compressed = (u8*)malloc(__Size);
+
+	// encode levels, each downsampled from the previous one
+	u8* __Pixels = data;
+	vector<u8> __Downsampled[2];
+	for (u8 i=0;i<levels.size();i++)
+	{
+		TextureLevel& p_Level = levels[i];
+		if (i)
+		{
+			vector<u8>& p_Target = __Downsampled[i&1];
+			p_Target.resize(p_Level.width*p_Level.height*4);
+			_downsample(&p_Target[0],__Pixels,levels[i-1].width,levels[i-1].height,m_Format);
+			__Pixels = &p_Target[0];
+		}
+
+		// gather 4x4 blocks, edges of levels not aligned to the block grid repeat their last pixel
+		u8* __Block = __Compressed+p_Level.offset;
+		for (s32 by=0;by<p_Level.height;by+=4)
+		{
+			for (s32 bx=0;bx<p_Level.width;bx+=4)
+			{
+				u8 __BlockPixels[64];
+				for (u8 j=0;j<16;j++)
+				{
+					s32 __X = glm::min(bx+(j&3),p_Level.width-1),__Y = glm::min(by+(j>>2),p_Level.height-1);
+					memcpy(__BlockPixels+j*4,__Pixels+(__Y*p_Level.width+__X)*4,4);
+				}
+				_encode_block(__Block,__BlockPixels,m_CompressedFormat);
+				__Block += __BlockSize;
+			}
+		}
+	}
+
+	// swap decoded data for the compressed chain
 	_free();
+	data = __Compressed;
+	m_TextureFlag = false;
+}
+
+/**
+ *	read block compressed mip chain from ktx cache
+ *	\param path: path to cache file
+ *	\param source: content hash of the source file
+ *	\returns true if the cache exists and matches source & format
+ */
+bool TextureData::_read_cache(const char* path,u64 source)
+{
+	MappedFile __Cache;
+	if (!__Cache.open(path)) return false;
+
+	// validate header, source & format
+	KTXHeader* p_Header = (KTXHeader*)__Cache.data;
+	KTXSourceKey* p_Key = (KTXSourceKey*)(__Cache.data+sizeof(KTXHeader));
+	bool __Valid = __Cache.size>=sizeof(KTXHeader)+sizeof(KTXSourceKey)
+			&&!memcmp(p_Header->identifier,BUFFER_KTX_IDENTIFIER,sizeof(BUFFER_KTX_IDENTIFIER))
+			&&p_Header->endianness==BUFFER_KTX_ENDIANNESS&&!p_Header->gl_type&&p_Header->faces==1
+			&&(p_Header->gl_internal_format==_texture_format_compressed[m_Format][0]
+			   ||p_Header->gl_internal_format==_texture_format_compressed[m_Format][1])
+			&&p_Header->mipmap_levels&&p_Header->key_value_bytes==sizeof(KTXSourceKey)
+			&&!strcmp(p_Key->key,"source_hash")&&p_Key->source_hash==source;
+	if (!__Valid)
+	{
+		COMM_LOG("texture cache %s is outdated and will be rebuilt",path);
+		return false;
+	}
+
+	// locate levels, each prefixed by its size
+	u8* __Cursor = __Cache.data+sizeof(KTXHeader)+sizeof(KTXSourceKey);
+	u8* __End = __Cache.data+__Cache.size;
+	u32 __Size = 0;
+	s32 __Width = p_Header->pixel_width,__Height = p_Header->pixel_height;
+	for (u32 i=0;i<p_Header->mipmap_levels&&__Valid;i++)
+	{
+		__Valid = __End-__Cursor>=(s64)sizeof(u32);
+		if (!__Valid) break;
+		u32 __LevelSize = *(u32*)__Cursor;
+		__Cursor += sizeof(u32);
+		__Valid = __End-__Cursor>=__LevelSize;
+		levels.push_back({ __Size,__LevelSize,__Width,__Height });
+		__Cursor += __LevelSize;
+		__Size += __LevelSize;
+		__Width = glm::max(__Width>>1,1);
+		__Height = glm::max(__Height>>1,1);
+	}
+	if (!__Valid)
+	{
+		COMM_LOG("texture cache %s is truncated and will be rebuilt",path);
+		levels.clear();
+		return false;
+	}
+
+	// copy levels out of mapped memory, uploading happens later on the main thread
+	width = p_Header->pixel_width;
+	height = p_Header->pixel_height;
+	m_CompressedFormat = p_Header->gl_internal_format;
+	data = (u8*)malloc(__Size);
+	__Cursor = __Cache.data+sizeof(KTXHeader)+sizeof(KTXSourceKey);
+	for (TextureLevel& p_Level : levels)
+	{
+		memcpy(data+p_Level.offset,__Cursor+sizeof(u32),p_Level.size);
+		__Cursor += sizeof(u32)+p_Level.size;
+	}
+	return true;
+}
+
+/**
+ *	write block compressed mip chain to ktx cache
+ *	\param path: path to cache file
+ *	\param source: content hash of the source file
+ *	NOTE the cache is written to a temporary file first & renamed, so concurrent loads never read partial caches
+ *	NOTE block sizes are multiples of 4 bytes, so levels need no padding
+ */
+void TextureData::_write_cache(const char* path,u64 source)
+{
+	string __TemporaryPath = string(path)+".tmp";
+	FILE* __File = fopen(__TemporaryPath.c_str(),"wb");
+	if (__File==NULL)
+	{
+		COMM_ERR("texture cache %s could not be written",path);
+		return;
+	}
+
+	// write header & source identity
+	bool __Alpha = m_CompressedFormat==_texture_format_compressed[m_Format][1];
+	KTXHeader __Header = {
+		.endianness = BUFFER_KTX_ENDIANNESS,
+		.gl_type = 0,
+		.gl_type_size = 1,
+		.gl_format = 0,
+		.gl_internal_format = m_CompressedFormat,
+		.gl_base_internal_format = _texture_format_base[m_Format][__Alpha],
+		.pixel_width = (u32)width,
+		.pixel_height = (u32)height,
+		.pixel_depth = 0,
+		.array_elements = 0,
+		.faces = 1,
+		.mipmap_levels = (u32)levels.size(),
+		.key_value_bytes = sizeof(KTXSourceKey)
+	};
+	memcpy(__Header.identifier,BUFFER_KTX_IDENTIFIER,sizeof(BUFFER_KTX_IDENTIFIER));
+	KTXSourceKey __Key;
+	__Key.source_hash = source;
+	bool __Written = fwrite(&__Header,sizeof(KTXHeader),1,__File)==1
+			&&fwrite(&__Key,sizeof(KTXSourceKey),1,__File)==1;
+
+	// write levels
+	for (u8 i=0;i<levels.size()&&__Written;i++)
+	{
+		__Written = fwrite(&levels[i].size,sizeof(u32),1,__File)==1
+				&&fwrite(data+levels[i].offset,levels[i].size,1,__File)==1;
+	}
+	__Written = !fclose(__File)&&__Written;
+
+	// publish cache
+	if (__Written&&!rename(__TemporaryPath.c_str(),path)) return;
+	COMM_ERR("texture cache %s could not be written",path);
+	remove(__TemporaryPath.c_str());
 }
 
 /**
@@ -261,6 +1043,26 @@ void Texture::set_texture_parameter_filter_bias(float bias)
 	glTexParameterf(GL_TEXTURE_2D,GL_TEXTURE_LOD_BIAS,bias);
 }
 
+/**
+ *	attach texture as colour source of the bound read framebuffer, e.g. to copy its pixels
+ */
+void Texture::attach_read_framebuffer()
+{
+	glFramebufferTexture2D(GL_READ_FRAMEBUFFER,GL_COLOR_ATTACHMENT0,GL_TEXTURE_2D,m_Memory,0);
+}
+
+/**
+ *	restrict sampled mip levels to uploaded range
+ *	\param base: finest level to sample
+ *	\param max: coarsest level to sample
+ *	NOTE texture should be bound
+ */
+void Texture::set_texture_parameter_level_range(u8 base,u8 max)
+{
+	glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_BASE_LEVEL,base);
+	glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAX_LEVEL,max);
+}
+
 /**
  *	define border colour for texture when set_texture_parameter_clamp_to_border() is defined
  *	\param colour: RGBA border colour as vector
@@ -285,15 +1087,40 @@ void Texture::generate_mipmap()
 // ----------------------------------------------------------------------------------------------------
 // Pixel Buffer Feature
 
+// freetype faces share one library, face creation & destruction is not thread-safe
+std::mutex _freetype_mutex;
+
+/**
+ *	look up glyph by codepoint, missing glyphs are requested for rasterization
+ *	\param codepoint: unicode codepoint
+ *	\returns cached glyph, its metrics & atlas coordinates are only valid when it is ready
+ *	NOTE main thread only, requested glyphs are submitted to the workers by the renderer once per frame
+ */
+Glyph& Font::glyph(u32 codepoint)
+{
+	Glyph& p_Glyph = glyphs[codepoint];
+	u8 __Missing = GLYPH_STATE_MISSING;
+	if (!p_Glyph.state.compare_exchange_strong(__Missing,GLYPH_STATE_QUEUED)) return p_Glyph;
+	p_Glyph.codepoint = codepoint;
+	pending.push_back(&p_Glyph);
+	return p_Glyph;
+}
+
 /**
  *	calculate estimated word length in given font
- *	\param word: given word for length estimation
- *	\param offset: (default 0) wordlength character offset to exclude buffer tail
+ *	\param word: given utf-8 encoded word for length estimation
+ *	\param offset: (default 0) wordlength byte offset to exclude buffer tail
+ *	NOTE glyphs, which are not rasterized yet, do not advance
  */
 f32 Font::estimate_wordlength(string& word,u32 offset)
 {
 	f32 out = .0f;
-	for (u32 i=0;i<word.size()-offset;i++) out += glyphs[word[i]-32].advance;
+	u32 i = 0;
+	while (i<word.size()-offset)
+	{
+		Glyph& p_Glyph = glyph(decode_utf8(word,i));
+		out += (p_Glyph.ready()) ? p_Glyph.advance : 0;
+	}
 	return out;
 }
 
@@ -307,19 +1134,206 @@ f32 Font::estimate_wordlength(string& word,u32 offset)
 void GPUPixelBuffer::allocate(u32 width,u32 height,u32 format)
 {
 	// store info
+	this->width = width;
+	this->height = height;
+	this->format = format;
 	dimensions_inv = vec2(1.f/width,1.f/height);
 
-	// allocate memory
-	memory_segments.push_back({
-			.offset = vec2(0,0),
-			.dimensions = vec2(width,height)
-		});
-	glTexImage2D(GL_TEXTURE_2D,0,format,width,height,0,format,GL_UNSIGNED_BYTE,0);
+	// allocate memory for all mip levels, the cpu shadow mirrors them to downsample changed regions only
+	packer.reset(width,height);
+	pixel_bytes = (format==GL_RED) ? 1 : 4;
+	levels.clear();
+	u32 __Offset = 0;
+	s32 __Width = width,__Height = height;
+	while (true)
+	{
+		u32 __Size = __Width*__Height*pixel_bytes;
+		glTexImage2D(GL_TEXTURE_2D,levels.size(),format,__Width,__Height,0,format,GL_UNSIGNED_BYTE,0);
+		levels.push_back({ __Offset,__Size,__Width,__Height });
+		__Offset += __Size;
+		if (__Width==1&&__Height==1) break;
+		__Width = glm::max(__Width>>1,1), __Height = glm::max(__Height>>1,1);
+	}
+	shadow.assign(__Offset,0);
 }
 // FIXME inconsistent formatting, the allocation format can easily be detached from texture data structure
 // FIXME in case of sRGB colourspace for example the format in internalformat and format won't be the same
 //		furthermore this is absolutely necessary to be of dynamic nature, due to monochrome buffers being a thing
 
+/**
+ *	reset packer to a single free rectangle
+ *	\param width: atlas width in pixels
+ *	\param height: atlas height in pixels
+ */
+void AtlasPacker::reset(s32 width,s32 height)
+{
+	m_Width = width;
+	m_Height = height;
+	m_Free = { { 0,0,width,height } };
+	m_Used.clear();
+	m_UsedArea = 0;
+	m_Fragmented = false;
+}
+
+/**
+ *	find & occupy space for a rectangle
+ *	\param width: rectangle width
+ *	\param height: rectangle height
+ *	\param rect: output occupied space
+ *	\returns false if the rectangle does not fit, not even after recovering maximal free space
+ */
+bool AtlasPacker::insert(s32 width,s32 height,AtlasRect& rect)
+{
+	if (!_find(width,height,rect))
+	{
+		if (!m_Fragmented) return false;
+		_rebuild();
+		if (!_find(width,height,rect)) return false;
+	}
+	occupy(rect);
+	return true;
+}
+
+/**
+ *	mark space as used
+ *	\param rect: occupied space, has to be free
+ */
+void AtlasPacker::occupy(AtlasRect& rect)
+{
+	_split(rect);
+	m_Used.push_back(rect);
+	m_UsedArea += (u64)rect.width*rect.height;
+}
+
+/**
+ *	return used space to the free rectangles, merged with free neighbours sharing a full edge
+ *	\param rect: space to release, as returned by insert
+ *	NOTE maximal free space is only recovered by the next failing insertion, to keep releases cheap
+ */
+void AtlasPacker::remove(AtlasRect& rect)
+{
+	for (u32 i=0;i<m_Used.size();i++)
+	{
+		if (m_Used[i].x!=rect.x||m_Used[i].y!=rect.y) continue;
+		m_Used[i] = m_Used.back();
+		m_Used.pop_back();
+		m_UsedArea -= (u64)rect.width*rect.height;
+		break;
+	}
+
+	// grow released space by its neighbours, until no neighbour is left to merge
+	AtlasRect __Released = rect;
+	bool __Merged = true;
+	while (__Merged)
+	{
+		__Merged = false;
+		for (u32 i=0;i<m_Free.size()&&!__Merged;i++)
+		{
+			AtlasRect& p_Free = m_Free[i];
+			if (p_Free.x==__Released.x&&p_Free.width==__Released.width
+				&&(p_Free.y+p_Free.height==__Released.y||__Released.y+__Released.height==p_Free.y))
+			{
+				__Released.y = glm::min(__Released.y,p_Free.y);
+				__Released.height += p_Free.height;
+				__Merged = true;
+			}
+			else if (p_Free.y==__Released.y&&p_Free.height==__Released.height
+					 &&(p_Free.x+p_Free.width==__Released.x||__Released.x+__Released.width==p_Free.x))
+			{
+				__Released.x = glm::min(__Released.x,p_Free.x);
+				__Released.width += p_Free.width;
+				__Merged = true;
+			}
+			if (!__Merged) continue;
+			m_Free[i] = m_Free.back();
+			m_Free.pop_back();
+		}
+	}
+	m_Free.push_back(__Released);
+	m_Fragmented = true;
+}
+
+/**
+ *	find free space for a rectangle by best short side fit
+ *	\param width: rectangle width
+ *	\param height: rectangle height
+ *	\param rect: output free space
+ *	\returns false if no free rectangle is large enough
+ */
+bool AtlasPacker::_find(s32 width,s32 height,AtlasRect& rect)
+{
+	// minimize the shorter leftover side, the longer one breaks ties
+	s32 __Best = -1;
+	s32 __BestShort = 0x7fffffff,__BestLong = 0x7fffffff;
+	for (u32 i=0;i<m_Free.size();i++)
+	{
+		AtlasRect& p_Free = m_Free[i];
+		if (width>p_Free.width||height>p_Free.height) continue;
+		s32 __Short = glm::min(p_Free.width-width,p_Free.height-height);
+		s32 __Long = glm::max(p_Free.width-width,p_Free.height-height);
+		if (__Short>__BestShort||(__Short==__BestShort&&__Long>=__BestLong)) continue;
+		__Best = i;
+		__BestShort = __Short;
+		__BestLong = __Long;
+	}
+	if (__Best<0) return false;
+	rect = { m_Free[__Best].x,m_Free[__Best].y,width,height };
+	return true;
+}
+
+/**
+ *	split all free rectangles overlapping the occupied space into their maximal remainders
+ *	\param rect: occupied space
+ */
+void AtlasPacker::_split(AtlasRect& rect)
+{
+	vector<AtlasRect> __Remainders;
+	for (u32 i=0;i<m_Free.size();)
+	{
+		AtlasRect __Free = m_Free[i];
+		if (!_atlas_overlap(__Free,rect))
+		{
+			i++;
+			continue;
+		}
+		m_Free[i] = m_Free.back();
+		m_Free.pop_back();
+
+		// remaining space left, right, above & below the occupied space
+		if (rect.x>__Free.x) __Remainders.push_back({ __Free.x,__Free.y,rect.x-__Free.x,__Free.height });
+		if (rect.x+rect.width<__Free.x+__Free.width)
+			__Remainders.push_back({ rect.x+rect.width,__Free.y,__Free.x+__Free.width-rect.x-rect.width,__Free.height });
+		if (rect.y>__Free.y) __Remainders.push_back({ __Free.x,__Free.y,__Free.width,rect.y-__Free.y });
+		if (rect.y+rect.height<__Free.y+__Free.height)
+			__Remainders.push_back({ __Free.x,rect.y+rect.height,__Free.width,__Free.y+__Free.height-rect.y-rect.height });
+	}
+
+	// drop remainders contained in other free space, untouched free rectangles can not be contained in remainders
+	for (u32 i=0;i<__Remainders.size();i++)
+	{
+		AtlasRect& p_Remainder = __Remainders[i];
+		bool __Contained = false;
+		for (u32 j=0;j<m_Free.size()&&!__Contained;j++) __Contained = _atlas_contains(m_Free[j],p_Remainder);
+		for (u32 j=0;j<__Remainders.size()&&!__Contained;j++)
+		{
+			__Contained = i!=j&&_atlas_contains(__Remainders[j],p_Remainder)
+					&&!_atlas_contains(p_Remainder,__Remainders[j]);
+		}
+		if (!__Contained) m_Free.push_back(p_Remainder);
+	}
+}
+
+/**
+ *	recover maximal free rectangles by splitting the whole atlas space by all used rectangles
+ */
+void AtlasPacker::_rebuild()
+{
+	m_Free = { { 0,0,m_Width,m_Height } };
+	for (AtlasRect& p_Used : m_Used) _split(p_Used);
+	m_Fragmented = false;
+}
+
+
 /**
  *	load texture from path and finally upload to gpu memory
  *	\param gpb: target pixel buffer
@@ -332,59 +1346,82 @@ void GPUPixelBuffer::load_texture(GPUPixelBuffer* gpb,PixelBufferComponent* pbc,
 	// load information from texture file
 	TextureData __TextureData;
 	__TextureData.load(path);
-	gpb->signal.proceed();
 
-	// upload to gpu memory & signal data safety
+	// upload to gpu memory & signal data safety, atlas coordinates are written by now
 	_load(gpb,pbc,&__TextureData);
+	gpb->signal.proceed();
 }
 
 /**
- *	load font data and finally upload to gpu memory
+ *	open font face, glyphs are rasterized on first use
  *	\param gpb: target pixel buffer
  *	\param font: pointer to target font memory
  *	\param path: path to font file
- *	\param size: target rasterization size of vector font
  *	NOTE this is supposed to run as a subthread, hence the mutex and load request queue pointer
  */
-void GPUPixelBuffer::load_font(GPUPixelBuffer* gpb,Font* font,const char* path,u16 size)
+void GPUPixelBuffer::load_font(GPUPixelBuffer* gpb,Font* font,const char* path)
 {
-	font->size = size;
-
-	// load ttf file
-	FT_Face __Face;
-	bool _failed = FT_New_Face(g_FreetypeLibrary,path,0,&__Face);
+	// faces of a shared freetype library have to be created in sequence
+	_freetype_mutex.lock();
+	bool _failed = FT_New_Face(g_FreetypeLibrary,path,0,&font->face);
+	_freetype_mutex.unlock();
 	COMM_ERR_COND(_failed,"font loading unsuccessful");
-	FT_Set_Pixel_Sizes(__Face,0,size);
+	FT_Set_Pixel_Sizes(font->face,0,font->size);
+	gpb->signal.proceed();
+}
 
-	// iterate font glyphs
-	for (u8 i=0;i<96;i++)
+/**
+ *	rasterize requested glyphs as signed distance fields & upload them to gpu memory
+ *	\param gpb: target pixel buffer
+ *	\param font: font of the requested glyphs
+ *	\param glyphs: requested glyphs
+ *	NOTE this is supposed to run as a subthread, the face is locked while rasterizing
+ *	NOTE glyphs, which do not fit into the atlas, fall back to missing & are requested again with the next relayout
+ */
+void GPUPixelBuffer::load_glyphs(GPUPixelBuffer* gpb,Font* font,vector<Glyph*> glyphs)
+{
+	bool __Ready = false;
+	std::lock_guard<std::mutex> lock(font->mutex_face);
+	for (Glyph* p_Glyph : glyphs)
 	{
-		// rasterize glyph
-		_failed = FT_Load_Char(__Face,i+32,FT_LOAD_RENDER);
-		COMM_ERR_COND(_failed,"rasterization of character %c failed",(char)i+32);
-
-		// subtexture attributes
-		TextureData __TextureData = TextureData(TEXTURE_FORMAT_MONOCHROME);
-		__TextureData.width = __Face->glyph->bitmap.width;
-		__TextureData.height = __Face->glyph->bitmap.rows;
+		// rasterize distance field, bitmap & bearing include the spread around the outline
+		FT_GlyphSlot p_Slot = font->face->glyph;
+		bool _failed = FT_Load_Char(font->face,p_Glyph->codepoint,FT_LOAD_DEFAULT);
+		_failed = _failed||(p_Slot->format==FT_GLYPH_FORMAT_OUTLINE&&p_Slot->outline.n_contours
+							&&FT_Render_Glyph(p_Slot,FT_RENDER_MODE_SDF));
+		COMM_ERR_COND(_failed,"rasterization of codepoint U+%04X failed",p_Glyph->codepoint);
+		bool __Empty = _failed||p_Slot->format!=FT_GLYPH_FORMAT_BITMAP||!p_Slot->bitmap.width||!p_Slot->bitmap.rows;
 
 		// glyph attributes
-		font->glyphs[i] = {
-			.scale = vec2(__Face->glyph->bitmap.width,__Face->glyph->bitmap.rows),
-			.bearing = vec2(__Face->glyph->bitmap_left,__Face->glyph->bitmap_top),
-			.advance = (__Face->glyph->advance.x>>6)
-		};
-
-		// upload glyph as texture buffer
-		size_t __Mem = __Face->glyph->bitmap.pitch*__Face->glyph->bitmap.rows;
-		__TextureData.data = (u8*)malloc(__Mem);
-		memcpy(__TextureData.data,__Face->glyph->bitmap.buffer,__Mem);
-		_load(gpb,&font->tex[i],&__TextureData);
-	}
-	gpb->signal.proceed();
+		p_Glyph->scale = (__Empty) ? vec2(0) : vec2(p_Slot->bitmap.width,p_Slot->bitmap.rows);
+		p_Glyph->bearing = vec2(p_Slot->bitmap_left,p_Slot->bitmap_top);
+		p_Glyph->advance = (_failed) ? 0 : p_Slot->advance.x>>6;
+		p_Glyph->comp = {  };
 
-	// store & clear
-	FT_Done_Face(__Face);
+		// upload distance field as subtexture, whitespace has nothing to upload
+		if (!__Empty)
+		{
+			TextureData __TextureData = TextureData(TEXTURE_FORMAT_MONOCHROME);
+			__TextureData.width = p_Slot->bitmap.width;
+			__TextureData.height = p_Slot->bitmap.rows;
+			__TextureData.data = (u8*)malloc(__TextureData.width*__TextureData.height);
+			for (s32 y=0;y<__TextureData.height;y++)
+			{
+				memcpy(__TextureData.data+y*__TextureData.width,p_Slot->bitmap.buffer+y*p_Slot->bitmap.pitch,
+					   __TextureData.width);
+			}
+			if (!_load(gpb,&p_Glyph->comp,&__TextureData))
+			{
+				free(__TextureData.data);
+				p_Glyph->state = GLYPH_STATE_MISSING;
+				font->overflow = true;
+				continue;
+			}
+		}
+		p_Glyph->state = GLYPH_STATE_READY;
+		__Ready = true;
+	}
+	if (__Ready) font->revision++;
 }
 
 /**
@@ -392,95 +1429,323 @@ void GPUPixelBuffer::load_font(GPUPixelBuffer* gpb,Font* font,const char* path,u
  *	\param gpb: target pixel buffer
  *	\param pbc: pointer to atlas component information, this will be overwritten
  *	\param data: texture data
+ *	\returns false if the subtexture does not fit into the atlas
  *	NOTE this is supposed to run as a subthread, hence the mutex and load request queue pointer
  */
-void GPUPixelBuffer::_load(GPUPixelBuffer* gpb,PixelBufferComponent* pbc,TextureData* data)
+bool GPUPixelBuffer::_load(GPUPixelBuffer* gpb,PixelBufferComponent* pbc,TextureData* data)
 {
-	// locate best position for texture on free memory space
-	f32 __BestDifference = 0x7f800000;
-	u32 __MemoryIndex = -1;
-	for (u32 i=0;i<gpb->memory_segments.size();i++)
+	// reserve padded pixel space, repack the atlas if fragmentation is the only reason it does not fit.
+	// repacking is skipped when the free area is too small for the subtexture in any arrangement
+	s32 __PaddedWidth = data->width+BUFFER_ATLAS_BORDER_PADDING;
+	s32 __PaddedHeight = data->height+BUFFER_ATLAS_BORDER_PADDING;
+	f32 __Demand = (f32)__PaddedWidth*__PaddedHeight/((f32)gpb->width*gpb->height);
+	AtlasRect __Rect;
+	vector<AtlasRect> __Dirty;
+	gpb->mutex_allocations.lock();
+	f32 __Occupancy = gpb->packer.occupancy();
+	bool __Placed = gpb->packer.insert(__PaddedWidth,__PaddedHeight,__Rect)
+			||(gpb->defragment&&__Occupancy+__Demand<=1.f
+			   &&_repack(gpb,__PaddedWidth,__PaddedHeight,__Rect,__Dirty));
+	if (__Placed) gpb->allocations[pbc] = { __Rect,__Rect,false };
+	gpb->mutex_allocations.unlock();
+	if (!__Placed)
 	{
-		PixelBufferComponent* p_FreeComponent = &gpb->memory_segments[i];
-		if (data->width>p_FreeComponent->dimensions.x
-			||data->height>p_FreeComponent->dimensions.y) continue;
-
-		// find closest fit
-		f32 __AreaDifference = p_FreeComponent->dimensions.x*p_FreeComponent->dimensions.y
-				- data->width*data->height;
-		if (__AreaDifference<__BestDifference)
-		{
-			__MemoryIndex = i;
-			__BestDifference = __AreaDifference;
-		}
+		COMM_ERR("texture atlas memory is populated or segmented at %.1f%% occupancy. texture upload failed!",
+				 __Occupancy*100.f);
+		COMM_MSG(LOG_CYAN,"attempted load dimensions -> (%i,%i)",data->width,data->height);
+		return false;
 	}
 
-	// get memory segment pointer
-	COMM_ERR_COND(__MemoryIndex==-1,"sprite texture memory is populated or segmented. texture upload failed!");
-	COMM_MSG_COND(__MemoryIndex==-1,LOG_CYAN,"attempted load dimensions -> (%i,%i)",data->width,data->height);
-	PixelBufferComponent* p_CloseFitComponent = &gpb->memory_segments[__MemoryIndex];
-
 	// write atlas information
-	data->x = p_CloseFitComponent->offset.x, data->y = p_CloseFitComponent->offset.y;
-	pbc->offset = p_CloseFitComponent->offset*gpb->dimensions_inv;
+	data->x = __Rect.x, data->y = __Rect.y;
+	pbc->offset = vec2(__Rect.x,__Rect.y)*gpb->dimensions_inv;
 	pbc->dimensions = vec2(data->width,data->height)*gpb->dimensions_inv;
 
-	// segment free memory to reserve pixel space for upload
-	s32 __PaddedWidth = data->width+BUFFER_ATLAS_BORDER_PADDING;
-	s32 __PaddedHeight = data->height+BUFFER_ATLAS_BORDER_PADDING;
-	PixelBufferComponent __Side = {
-		.offset = p_CloseFitComponent->offset+vec2(__PaddedWidth,0),
-		.dimensions = vec2(p_CloseFitComponent->dimensions.x-__PaddedWidth,__PaddedHeight)
-	};
-	PixelBufferComponent __Below = {
-		.offset = p_CloseFitComponent->offset+vec2(0,__PaddedHeight),
-		.dimensions = p_CloseFitComponent->dimensions-vec2(0,__PaddedHeight)
-	};
-	// FIXME this is segmenting falsely, it's not possible to insert into texture space that has the correct
-	//		dimensions in only one segment but crosses over into a different free rect.
-	//		alternatively this can be done by assigning cross segment in both subsequent segments, but
-	//		this will mess with memory information, due to multiple free states per pixel. geez louize
-	//		solve this with a consistent merger algorithm after every segment?
-
-	// update memory information data
-	gpb->mutex_memory_segments.lock();
-	gpb->memory_segments.erase(gpb->memory_segments.begin()+__MemoryIndex);
-	if (__Side.dimensions.x>0) gpb->memory_segments.push_back(__Side);
-	if (__Below.dimensions.y>0) gpb->memory_segments.push_back(__Below);
-	gpb->mutex_memory_segments.unlock();
-	// TODO when deleting and segmenting, check if free subspaces can be merged back into each other
+	// mirror subtexture in the shadow, padding is cleared so released pixels do not bleed into coarse levels
+	gpb->mutex_shadow.lock();
+	u8 __Bytes = gpb->pixel_bytes;
+	for (s32 y=0;y<__Rect.height;y++)
+	{
+		u8* p_Row = &gpb->shadow[((size_t)(__Rect.y+y)*gpb->width+__Rect.x)*__Bytes];
+		memset(p_Row,0,__Rect.width*__Bytes);
+		if (y<data->height&&data->data!=nullptr) memcpy(p_Row,data->data+(size_t)y*data->width*__Bytes,data->width*__Bytes);
+	}
+	gpb->mutex_shadow.unlock();
+	__Dirty.push_back(__Rect);
+	_update_mips(gpb,__Dirty);
 
 	// write buffer
 	gpb->mutex_texture_requests.lock();
-	gpb->load_requests.push(*data);
+	gpb->load_requests.push({ *data,pbc });
+	gpb->mutex_texture_requests.unlock();
+	return true;
+}
+
+/**
+ *	repack all uploaded subtextures from the largest down, to reclaim fragmented free space
+ *	\param gpb: target pixel buffer
+ *	\param width: padded width of the subtexture, which failed to be inserted
+ *	\param height: padded height of the subtexture, which failed to be inserted
+ *	\param rect: output space of the inserted subtexture within the repacked layout
+ *	\param moved: output space of moved subtextures, their coarse mip levels are outdated
+ *	\returns true if everything fits into the repacked layout, the current layout is kept otherwise
+ *	NOTE allocation mutex has to be locked by the caller
+ *	NOTE subtextures waiting for upload keep their place, moved pixels follow on the gpu with the next upload
+ *	NOTE the shadow is moved immediately, so subtextures loaded into vacated space can not overwrite moved pixels
+ */
+bool GPUPixelBuffer::_repack(GPUPixelBuffer* gpb,s32 width,s32 height,AtlasRect& rect,vector<AtlasRect>& moved)
+{
+	if (gpb->relocation_pending||gpb->packer.free_area()<(u64)width*height) return false;
+
+	// pin pending subtextures & gather movable ones
+	AtlasPacker __Packer;
+	__Packer.reset(gpb->width,gpb->height);
+	vector<AtlasAllocation*> __Movable;
+	for (std::pair<PixelBufferComponent* const,AtlasAllocation>& p_Pair : gpb->allocations)
+	{
+		if (p_Pair.second.uploaded) __Movable.push_back(&p_Pair.second);
+		else __Packer.occupy(p_Pair.second.rect);
+	}
+	std::sort(__Movable.begin(),__Movable.end(),[](AtlasAllocation* a,AtlasAllocation* b)
+			  { return glm::max(a->rect.width,a->rect.height)>glm::max(b->rect.width,b->rect.height); });
+
+	// pack into fresh layout
+	vector<AtlasRect> __Rects(__Movable.size());
+	for (u32 i=0;i<__Movable.size();i++)
+	{
+		if (!__Packer.insert(__Movable[i]->rect.width,__Movable[i]->rect.height,__Rects[i])) return false;
+	}
+	if (!__Packer.insert(width,height,rect)) return false;
+
+	// commit layout
+	COMM_LOG("repacking texture atlas at %.1f%% occupancy",gpb->packer.occupancy()*100.f);
+	gpb->packer = __Packer;
+	for (u32 i=0;i<__Movable.size();i++) __Movable[i]->rect = __Rects[i];
+	gpb->relocation_pending = true;
+
+	// stage moved shadow pixels first, because subtextures may move onto each other's former space
+	std::lock_guard<std::mutex> lock(gpb->mutex_shadow);
+	u8 __Bytes = gpb->pixel_bytes;
+	vector<vector<u8>> __Staging(__Movable.size());
+	for (u32 i=0;i<__Movable.size();i++)
+	{
+		AtlasAllocation& p_Allocation = *__Movable[i];
+		if (p_Allocation.rect.x==p_Allocation.source.x&&p_Allocation.rect.y==p_Allocation.source.y) continue;
+		size_t __Row = p_Allocation.source.width*__Bytes;
+		__Staging[i].resize(__Row*p_Allocation.source.height);
+		for (s32 y=0;y<p_Allocation.source.height;y++)
+		{
+			memcpy(&__Staging[i][y*__Row],
+				   &gpb->shadow[((size_t)(p_Allocation.source.y+y)*gpb->width+p_Allocation.source.x)*__Bytes],__Row);
+		}
+	}
+	for (u32 i=0;i<__Movable.size();i++)
+	{
+		if (!__Staging[i].size()) continue;
+		AtlasRect& p_Rect = __Movable[i]->rect;
+		size_t __Row = p_Rect.width*__Bytes;
+		for (s32 y=0;y<p_Rect.height;y++)
+			memcpy(&gpb->shadow[((size_t)(p_Rect.y+y)*gpb->width+p_Rect.x)*__Bytes],&__Staging[i][y*__Row],__Row);
+		moved.push_back(p_Rect);
+	}
+	return true;
+}
+
+/**
+ *	downsample changed regions of the shadow through all coarse mip levels & queue them for upload
+ *	\param gpb: target pixel buffer
+ *	\param regions: changed regions of the full resolution level
+ *	NOTE this is supposed to run as a subthread, the shadow is locked while downsampling
+ */
+void GPUPixelBuffer::_update_mips(GPUPixelBuffer* gpb,vector<AtlasRect>& regions)
+{
+	vector<AtlasMipUpdate> __Updates;
+	gpb->mutex_shadow.lock();
+	for (AtlasRect& p_Region : regions)
+	{
+		// a coarse texel changes if any of its 2x2 finer texels changed
+		AtlasMipUpdate __Update;
+		s32 __X0 = p_Region.x,__Y0 = p_Region.y;
+		s32 __X1 = p_Region.x+p_Region.width,__Y1 = p_Region.y+p_Region.height;
+		for (u8 i=1;i<gpb->levels.size();i++)
+		{
+			TextureLevel& p_Source = gpb->levels[i-1];
+			TextureLevel& p_Level = gpb->levels[i];
+			__X0 >>= 1, __Y0 >>= 1;
+			__X1 = glm::min((__X1+1)>>1,p_Level.width), __Y1 = glm::min((__Y1+1)>>1,p_Level.height);
+			if (__X0>=__X1||__Y0>=__Y1) break;
+			AtlasRect __Rect = { __X0,__Y0,__X1-__X0,__Y1-__Y0 };
+			_downsample_region(&gpb->shadow[p_Level.offset],&gpb->shadow[p_Source.offset],
+							   p_Source.width,p_Source.height,__Rect,gpb->pixel_bytes);
+			__Update.rects.push_back(__Rect);
+		}
+		if (__Update.rects.size()) __Updates.push_back(std::move(__Update));
+	}
+	gpb->mutex_shadow.unlock();
+
+	// queue uploads, regions are read from the shadow at upload time
+	gpb->mutex_texture_requests.lock();
+	for (AtlasMipUpdate& p_Update : __Updates) gpb->mip_requests.push(std::move(p_Update));
 	gpb->mutex_texture_requests.unlock();
 }
 
 /**
  *	automatically uploads the loaded subtextures to the gpu
  *	\param channel: texture channel
+ *	\param ring: pixel upload ring to stage subtextures through
  *	\param fstart: time the current frame started
  *	NOTE this has to be run in main thread due to the gpu upload being context sensitive
  */
-void GPUPixelBuffer::gpu_upload(u8 channel,std::chrono::steady_clock::time_point& fstart)
+void GPUPixelBuffer::gpu_upload(u8 channel,PixelUploadRing& ring,std::chrono::steady_clock::time_point& fstart)
 {
-	atlas.bind(channel);
 	mutex_texture_requests.lock();
+	mutex_allocations.lock();
+	bool __Idle = !load_requests.size()&&!mip_requests.size()&&!relocation_pending;
+	mutex_allocations.unlock();
+	if (__Idle)
+	{
+		mutex_texture_requests.unlock();
+		return;
+	}
 
-	// iterate waiting requests
-	while (load_requests.size()&&calculate_delta_time(fstart)<FRAME_TIME_BUDGET_MS)
+	// iterate waiting requests, until frame budget is spent or the upload ring is busy
+	atlas.bind(channel);
+	do
 	{
-		TextureData& p_Data = load_requests.front();
-		p_Data.gpu_upload_subtexture();
+		// a repacked layout has to be followed before uploading into it, repacking can not interleave
+		std::lock_guard<std::mutex> lock(mutex_allocations);
+		if (relocation_pending) _relocate(channel);
+		if (!load_requests.size()) break;
+		AtlasUpload& p_Upload = load_requests.front();
+		if (!p_Upload.data.gpu_upload_subtexture(ring)) break;
+		auto __Allocation = allocations.find(p_Upload.component);
+		if (__Allocation!=allocations.end()) __Allocation->second.uploaded = true;
 		load_requests.pop();
-	}
+	} while (load_requests.size()&&calculate_delta_time(fstart)<FRAME_TIME_BUDGET_MS);
 	COMM_LOG_COND(load_requests.size(),"stalling upload in pixel buffer");
 
-	// controversial pixel buffer lod creation
+	// coarse levels of changed regions, downsampled by the loading workers
+	while (mip_requests.size()&&calculate_delta_time(fstart)<FRAME_TIME_BUDGET_MS)
+	{
+		if (!_upload_mip(ring,mip_requests.front())) break;
+		mip_requests.pop();
+	}
 	mutex_texture_requests.unlock();
-	Texture::generate_mipmap();
 }
-// FIXME performance will suffer when generating mipmap every time the loop condition breaks
+
+/**
+ *	upload changed region through all coarse mip levels from the shadow, staged in a single ring allocation
+ *	\param ring: pixel upload ring
+ *	\param update: changed rectangles per level
+ *	\returns false if the ring was busy, the region has to be retried later
+ *	NOTE atlas has to be bound before uploading
+ *	NOTE levels are uploaded together, so the coarse levels never lag behind each other
+ */
+bool GPUPixelBuffer::_upload_mip(PixelUploadRing& ring,AtlasMipUpdate& update)
+{
+	size_t __Size = 0;
+	for (AtlasRect& p_Rect : update.rects) __Size += (size_t)p_Rect.width*p_Rect.height*pixel_bytes;
+	size_t __Staged;
+	u8* __Staging = ring.map(__Size,__Staged);
+	if (__Staging==nullptr) return false;
+
+	// copy rectangles of all levels consecutively
+	mutex_shadow.lock();
+	size_t __Offset = 0;
+	for (u8 i=0;i<update.rects.size();i++)
+	{
+		TextureLevel& p_Level = levels[i+1];
+		AtlasRect& p_Rect = update.rects[i];
+		size_t __Row = p_Rect.width*pixel_bytes;
+		for (s32 y=0;y<p_Rect.height;y++)
+		{
+			memcpy(__Staging+__Offset,
+				   &shadow[p_Level.offset+((size_t)(p_Rect.y+y)*p_Level.width+p_Rect.x)*pixel_bytes],__Row);
+			__Offset += __Row;
+		}
+	}
+	mutex_shadow.unlock();
+	ring.unmap();
+
+	// upload levels from their staged ranges
+	__Offset = __Staged;
+	for (u8 i=0;i<update.rects.size();i++)
+	{
+		AtlasRect& p_Rect = update.rects[i];
+		glTexSubImage2D(GL_TEXTURE_2D,i+1,p_Rect.x,p_Rect.y,p_Rect.width,p_Rect.height,format,GL_UNSIGNED_BYTE,
+						(void*)__Offset);
+		__Offset += (size_t)p_Rect.width*p_Rect.height*pixel_bytes;
+	}
+	ring.release();
+	return true;
+}
+
+/**
+ *	release atlas space of a subtexture
+ *	\param pbc: atlas component of the subtexture
+ */
+void GPUPixelBuffer::release(PixelBufferComponent* pbc)
+{
+	std::lock_guard<std::mutex> lock(mutex_allocations);
+	auto __Allocation = allocations.find(pbc);
+	if (__Allocation==allocations.end()) return;
+	packer.remove(__Allocation->second.rect);
+	allocations.erase(__Allocation);
+}
+
+/**
+ *	\returns fraction of the atlas occupied by subtextures, including their border padding
+ */
+f32 GPUPixelBuffer::occupancy()
+{
+	std::lock_guard<std::mutex> lock(mutex_allocations);
+	return packer.occupancy();
+}
+
+/**
+ *	move pixels of repacked subtextures to their assigned space & patch their atlas coordinates
+ *	\param channel: texture channel of the atlas
+ *	NOTE allocation mutex has to be locked by the caller
+ *	NOTE atlas contents are staged in a copy first, because subtextures may move onto each other's former space
+ */
+void GPUPixelBuffer::_relocate(u8 channel)
+{
+	s32 __ReadBinding;
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING,&__ReadBinding);
+	u32 __Framebuffer,__Staging;
+	glGenFramebuffers(1,&__Framebuffer);
+	glGenTextures(1,&__Staging);
+
+	// copy atlas to staging texture
+	glBindFramebuffer(GL_READ_FRAMEBUFFER,__Framebuffer);
+	atlas.attach_read_framebuffer();
+	glBindTexture(GL_TEXTURE_2D,__Staging);
+	glTexImage2D(GL_TEXTURE_2D,0,format,width,height,0,format,GL_UNSIGNED_BYTE,0);
+	glCopyTexSubImage2D(GL_TEXTURE_2D,0,0,0,0,0,width,height);
+
+	// copy moved subtextures back into the atlas
+	glFramebufferTexture2D(GL_READ_FRAMEBUFFER,GL_COLOR_ATTACHMENT0,GL_TEXTURE_2D,__Staging,0);
+	atlas.bind(channel);
+	for (std::pair<PixelBufferComponent* const,AtlasAllocation>& p_Pair : allocations)
+	{
+		AtlasAllocation& p_Allocation = p_Pair.second;
+		if (p_Allocation.rect.x==p_Allocation.source.x&&p_Allocation.rect.y==p_Allocation.source.y) continue;
+		glCopyTexSubImage2D(GL_TEXTURE_2D,0,p_Allocation.rect.x,p_Allocation.rect.y,
+							p_Allocation.source.x,p_Allocation.source.y,p_Allocation.rect.width,p_Allocation.rect.height);
+		p_Allocation.source = p_Allocation.rect;
+
+		// patch coordinates
+		PixelBufferComponent* p_Component = p_Pair.first;
+		p_Component->offset = vec2(p_Allocation.rect.x,p_Allocation.rect.y)*dimensions_inv;
+		relocated = true;
+	}
+
+	// cleanup
+	glBindFramebuffer(GL_READ_FRAMEBUFFER,__ReadBinding);
+	glDeleteFramebuffers(1,&__Framebuffer);
+	glDeleteTextures(1,&__Staging);
+	relocation_pending = false;
+}
 
 
 // ----------------------------------------------------------------------------------------------------
@@ -505,9 +1770,23 @@ Framebuffer::Framebuffer(u8 compcount)
  *	\param fbuffer: (default false) true if floatbuffer when extra precision is needed
  */
 void Framebuffer::define_colour_component(u8 index,f32 width,f32 height,bool fbuffer)
+{
+	define_colour_component(index,width,height,GL_RGBA+0x6f12*fbuffer,GL_RGBA,GL_UNSIGNED_INT+fbuffer);
+}
+
+/**
+ *	colour component definition with explicit storage, for compact targets with fewer or narrower channels
+ *	\param index: frambuffer component index
+ *	\param width: resolution width
+ *	\param height: resolution height
+ *	\param internal: sized internal format of the component, e.g. GL_RG16 or GL_RGBA8
+ *	\param format: pixel format matching the internal format's channels
+ *	\param type: pixel data type matching the internal format
+ */
+void Framebuffer::define_colour_component(u8 index,f32 width,f32 height,GLenum internal,GLenum format,GLenum type)
 {
 	glBindTexture(GL_TEXTURE_2D,m_ColourComponents[index]);
-	glTexImage2D(GL_TEXTURE_2D,0,GL_RGBA+0x6f12*fbuffer,width,height,0,GL_RGBA,GL_UNSIGNED_INT+fbuffer,NULL);
+	glTexImage2D(GL_TEXTURE_2D,0,internal,width,height,0,format,type,NULL);
 	Texture::set_texture_parameter_nearest_unfiltered();
 	glFramebufferTexture2D(GL_FRAMEBUFFER,GL_COLOR_ATTACHMENT0+index,GL_TEXTURE_2D,m_ColourComponents[index],0);
 }
@@ -516,12 +1795,14 @@ void Framebuffer::define_colour_component(u8 index,f32 width,f32 height,bool fbu
  *	depth component definition, only a single one per framebuffer allowed for obvious reasons
  *	\param width: resolution width
  *	\param height: resolution height
+ *	\param internal: (default GL_DEPTH_COMPONENT) depth format, explicitly sized when reconstructing from it
+ *	NOTE a float format does not add precision at range without reversed depth, values cluster towards 1.0
  */
-void Framebuffer::define_depth_component(f32 width,f32 height)
+void Framebuffer::define_depth_component(f32 width,f32 height,GLenum internal)
 {
 	glGenTextures(1,&m_DepthComponent);
 	glBindTexture(GL_TEXTURE_2D,m_DepthComponent);
-	glTexImage2D(GL_TEXTURE_2D,0,GL_DEPTH_COMPONENT,width,height,0,GL_DEPTH_COMPONENT,GL_UNSIGNED_INT,NULL);
+	glTexImage2D(GL_TEXTURE_2D,0,internal,width,height,0,GL_DEPTH_COMPONENT,GL_UNSIGNED_INT,NULL);
 	Texture::set_texture_parameter_nearest_unfiltered();
 	glFramebufferTexture2D(GL_FRAMEBUFFER,GL_DEPTH_ATTACHMENT,GL_TEXTURE_2D,m_DepthComponent,0);
 }
@@ -546,6 +1827,14 @@ void Framebuffer::start()
 	Frame::clear();
 }
 
+/**
+ *	continue recording to the framebuffer, keeping its current contents
+ */
+void Framebuffer::bind()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER,m_Buffer);
+}
+
 /**
  *	stop writing to the framebuffer
  */
@@ -574,3 +1863,17 @@ void Framebuffer::bind_depth_component(u8 channel)
 	Texture::set_channel(channel);
 	glBindTexture(GL_TEXTURE_2D,m_DepthComponent);
 }
+
+/**
+ *	copy depth component into another framebuffer and continue recording to the target
+ *	\param target: framebuffer to copy depth into, depth components have to match in format
+ *	\param width: copied region width, starting at the origin
+ *	\param height: copied region height, starting at the origin
+ */
+void Framebuffer::blit_depth_component(Framebuffer& target,u32 width,u32 height)
+{
+	glBindFramebuffer(GL_READ_FRAMEBUFFER,m_Buffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER,target.m_Buffer);
+	glBlitFramebuffer(0,0,width,height,0,0,width,height,GL_DEPTH_BUFFER_BIT,GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER,target.m_Buffer);
+}
@@ -16,6 +16,7 @@ public:
 
 	void bind();
 	static void unbind();
+	inline u32 get_id() { return m_VAO; }
 
 private:
 	u32 m_VAO;
@@ -28,6 +29,7 @@ public:
 	VertexBuffer();
 
 	void bind();
+	void bind_elements();
 	static void unbind();
 
 	/**
@@ -43,6 +45,25 @@ public:
 	template<typename T> inline void upload_vertices(vector<T> vertices,GLenum memtype=GL_STATIC_DRAW)
 	{ glBufferData(GL_ARRAY_BUFFER,vertices.size()*sizeof(T),&vertices[0],memtype); }
 
+	/**
+	 *	template inline to allocate vertex memory once, so it can be partially overwritten later
+	 *	\param size: amount of vertex structs the buffer should be able to hold
+	 *	\param memtype: (default GL_DYNAMIC_DRAW) GL_(STREAM+STATIC+DYNAMIC)_(DRAW+READ+COPY)
+	 *	NOTE vertex buffer has to be bound beforehand
+	 */
+	template<typename T> inline void allocate_vertices(size_t size,GLenum memtype=GL_DYNAMIC_DRAW)
+	{ glBufferData(GL_ARRAY_BUFFER,size*sizeof(T),nullptr,memtype); }
+
+	/**
+	 *	template inline to overwrite a range of previously allocated vertex memory
+	 *	\param vertices: pointer to the first vertex of the range
+	 *	\param offset: index of the first overwritten vertex in buffer memory
+	 *	\param size: amount of vertices in range
+	 *	NOTE vertex buffer has to be bound beforehand and allocated large enough to hold the range
+	 */
+	template<typename T> inline void upload_vertices_range(T* vertices,size_t offset,size_t size)
+	{ glBufferSubData(GL_ARRAY_BUFFER,offset*sizeof(T),size*sizeof(T),vertices); }
+
 	void upload_elements(u32* elements,size_t size);
 	void upload_elements(vector<u32> elements);
 
@@ -50,6 +71,59 @@ private:
 	u32 m_VBO;
 };
 
+class UniformBuffer
+{
+public:
+	UniformBuffer();
+
+	void bind();
+	void allocate(void* data,size_t size,u32 binding,GLenum memtype=GL_DYNAMIC_DRAW);
+	void upload(void* data,size_t offset,size_t size);
+
+private:
+	u32 m_UBO;
+};
+
+// buffer object sampled as texture, for arrays too large for uniform blocks, fetched by texel index in shaders
+class TextureBuffer
+{
+public:
+	TextureBuffer();
+
+	void bind(u8 channel);
+	void upload(void* data,size_t size,GLenum format);
+
+private:
+	u32 m_Buffer;
+	u32 m_Texture;
+	size_t m_Capacity = 0;
+};
+
+// ring of pixel unpack buffers, texture data is staged in them so the driver transfers it asynchronously.
+// uploads are sub-allocated linearly within a buffer, which is fenced once when it is full
+class PixelUploadRing
+{
+public:
+	PixelUploadRing();
+
+	u8* map(size_t size,size_t& offset);
+	void unmap();
+	void release();
+
+private:
+	void _advance();
+
+private:
+	u32 m_Buffers[BUFFER_UPLOAD_RING_SLOTS];
+	size_t m_Capacity[BUFFER_UPLOAD_RING_SLOTS] = { 0 };
+	GLsync m_Fences[BUFFER_UPLOAD_RING_SLOTS] = { 0 };
+	u8 m_Slot = 0;
+	size_t m_Cursor = 0;  // bytes allocated within the current buffer
+};
+
+// staging allocations start aligned, so any pixel or block format can be read from them
+constexpr size_t BUFFER_UPLOAD_ALIGNMENT = 16;
+
 
 // ----------------------------------------------------------------------------------------------------
 // Colour Buffers
@@ -58,7 +132,45 @@ enum TextureFormat
 {
 	TEXTURE_FORMAT_RGBA,
 	TEXTURE_FORMAT_SRGB,
-	TEXTURE_FORMAT_MONOCHROME
+	TEXTURE_FORMAT_MONOCHROME,
+	TEXTURE_FORMAT_NORMAL
+};
+
+// khronos texture container 1.1, holding block compressed mip chains
+constexpr u8 BUFFER_KTX_IDENTIFIER[] = { 0xab,0x4b,0x54,0x58,0x20,0x31,0x31,0xbb,0x0d,0x0a,0x1a,0x0a };
+constexpr u32 BUFFER_KTX_ENDIANNESS = 0x04030201;
+
+struct KTXHeader
+{
+	u8 identifier[12];
+	u32 endianness;
+	u32 gl_type;
+	u32 gl_type_size;
+	u32 gl_format;
+	u32 gl_internal_format;
+	u32 gl_base_internal_format;
+	u32 pixel_width;
+	u32 pixel_height;
+	u32 pixel_depth;
+	u32 array_elements;
+	u32 faces;
+	u32 mipmap_levels;
+	u32 key_value_bytes;
+};
+
+// key/value entry identifying the source image of a cached texture
+struct KTXSourceKey
+{
+	u32 size = sizeof(KTXSourceKey)-sizeof(u32);
+	char key[12] = "source_hash";
+	u64 source_hash;
+};
+
+struct TextureLevel
+{
+	u32 offset;
+	u32 size;
+	s32 width,height;
 };
 
 
@@ -68,20 +180,29 @@ public:
 	TextureData(TextureFormat format=TEXTURE_FORMAT_RGBA);
 
 	void load(const char* path);
-	void gpu_upload();
-	void gpu_upload_subtexture();
+	void load_compressed(const char* path);
+	static size_t decoded_size(const char* path);
+	bool gpu_upload(PixelUploadRing& ring);
+	bool gpu_upload_levels(PixelUploadRing& ring,u8 finest,u8 coarsest);
+	bool gpu_upload_subtexture(PixelUploadRing& ring);
+	inline bool compressed() { return levels.size(); }
 
 private:
+	void _compress();
+	bool _read_cache(const char* path,u64 source);
+	void _write_cache(const char* path,u64 source);
 	void _free();
 
 public:
 	u32 x,y;
 	s32 width,height;
 	u8* data;
+	vector<TextureLevel> levels;  // block compressed mip chain within data, empty for uncompressed data
 
 private:
 	TextureFormat m_Format;
 	bool m_TextureFlag = false;
+	u32 m_CompressedFormat;
 };
 
 class Texture
@@ -102,7 +223,12 @@ public:
 	static void set_texture_parameter_repeat();
 	static void set_texture_parameter_filter_bias(float bias=.0f);
 	static void set_texture_parameter_border_colour(vec4 colour);
+	static void set_texture_parameter_level_range(u8 base,u8 max);
 	static void generate_mipmap();
+	void attach_read_framebuffer();
+
+public:
+	f32 demand = .0f;  // texels required along the largest dimension by visible geometry, reset after streaming
 
 private:
 	u32 m_Memory;
@@ -115,46 +241,136 @@ struct PixelBufferComponent
 	vec2 dimensions = vec2(0,0);
 };
 
+enum GlyphState : u8
+{
+	GLYPH_STATE_MISSING,
+	GLYPH_STATE_QUEUED,
+	GLYPH_STATE_READY
+};
+
+// signed distance field glyph, metrics & atlas coordinates are written by the rasterizing worker
 struct Glyph
 {
-	vec2 scale;
-	vec2 bearing;
-	s64 advance;
+	// utility
+	inline bool ready() { return state==GLYPH_STATE_READY; }
+
+	// data
+	PixelBufferComponent comp;
+	vec2 scale = vec2(0);
+	vec2 bearing = vec2(0);
+	s64 advance = 0;
+	u32 codepoint;
+	u32 references = 0;  // texts displaying the glyph, only unreferenced glyphs can be evicted
+	u64 last_use = 0;
+	std::atomic<u8> state = GLYPH_STATE_MISSING;
 };
 
 struct Font
 {
 	// utility
+	Glyph& glyph(u32 codepoint);
 	f32 estimate_wordlength(string& word,u32 offset=0);
 
 	// data
-	PixelBufferComponent tex[96];
-	Glyph glyphs[96];
-	u16 size;
+	FT_Face face = nullptr;
+	std::mutex mutex_face;
+	map<u32,Glyph> glyphs;  // glyph cache by codepoint, entries are only touched by the main thread
+	vector<Glyph*> pending;  // requested glyphs, rasterized by the next glyph task
+	std::atomic<u32> revision = 0;  // increased whenever requested glyphs become ready, texts relayout on change
+	std::atomic<bool> overflow = false;  // set when requested glyphs did not fit into the atlas
+	u16 size = BUFFER_FONT_SDF_SIZE;
+};
+
+// atlas space in pixels
+struct AtlasRect
+{
+	s32 x,y;
+	s32 width,height;
 };
 
+// maxrects packer, free space is tracked as maximal & possibly overlapping rectangles
+class AtlasPacker
+{
+public:
+	void reset(s32 width,s32 height);
+	bool insert(s32 width,s32 height,AtlasRect& rect);
+	void occupy(AtlasRect& rect);
+	void remove(AtlasRect& rect);
+	inline f32 occupancy() { return (f64)m_UsedArea/((u64)m_Width*m_Height); }
+	inline u64 free_area() { return (u64)m_Width*m_Height-m_UsedArea; }
+
+private:
+	bool _find(s32 width,s32 height,AtlasRect& rect);
+	void _split(AtlasRect& rect);
+	void _rebuild();
+
+private:
+	vector<AtlasRect> m_Free;
+	vector<AtlasRect> m_Used;
+	s32 m_Width = 0,m_Height = 0;
+	u64 m_UsedArea = 0;
+	bool m_Fragmented = false;  // released space is merged with its neighbours only, free space is not maximal
+};
+
+struct AtlasAllocation
+{
+	AtlasRect rect;  // assigned space including border padding
+	AtlasRect source;  // space currently holding the pixels on the gpu, differs from rect until relocated
+	bool uploaded = false;
+};
+
+struct AtlasUpload
+{
+	TextureData data;
+	PixelBufferComponent* component;
+};
+
+// dirty region through all coarse mip levels, downsampled in the cpu shadow & waiting for upload
+struct AtlasMipUpdate
+{
+	vector<AtlasRect> rects;  // changed rectangle per level, starting with level 1
+};
+
+// relocated subtexture coordinates, for sprites to follow their texture
 struct GPUPixelBuffer
 {
 	// utilty
 	void allocate(u32 width,u32 height,u32 format);
 	static void load_texture(GPUPixelBuffer* gpb,PixelBufferComponent* pbc,const char* path);
-	static void load_font(GPUPixelBuffer* gpb,Font* font,const char* path,u16 size);
-	static void _load(GPUPixelBuffer* gpb,PixelBufferComponent* pbc,TextureData* data);
-	void gpu_upload(u8 channel,std::chrono::steady_clock::time_point& fstart);
+	static void load_font(GPUPixelBuffer* gpb,Font* font,const char* path);
+	static void load_glyphs(GPUPixelBuffer* gpb,Font* font,vector<Glyph*> glyphs);
+	static bool _load(GPUPixelBuffer* gpb,PixelBufferComponent* pbc,TextureData* data);
+	static bool _repack(GPUPixelBuffer* gpb,s32 width,s32 height,AtlasRect& rect,vector<AtlasRect>& moved);
+	static void _update_mips(GPUPixelBuffer* gpb,vector<AtlasRect>& regions);
+	void gpu_upload(u8 channel,PixelUploadRing& ring,std::chrono::steady_clock::time_point& fstart);
+	bool _upload_mip(PixelUploadRing& ring,AtlasMipUpdate& update);
+	void release(PixelBufferComponent* pbc);
+	f32 occupancy();
+	void _relocate(u8 channel);
 	// TODO allocate & write for statically written texture atlas
 	// TODO when allocating, rotation boolean can be stored in alpha by signing the float
-	// TODO allow to merge deleted rects when using a dynamic texture atlas
 	// FIXME format can be assigned when allocating but load instructions are format dependent
 
 	// data
 	Texture atlas;
+	u32 width,height;
+	u32 format;
 	vec2 dimensions_inv;
-	vector<PixelBufferComponent> memory_segments;
-	std::mutex mutex_memory_segments;
+	vector<u8> shadow;  // cpu copy of all mip levels, coarse levels are downsampled from it by the loading workers
+	vector<TextureLevel> levels;
+	u8 pixel_bytes;
+	std::mutex mutex_shadow;
+	AtlasPacker packer;
+	map<PixelBufferComponent*,AtlasAllocation> allocations;
+	std::mutex mutex_allocations;
+	bool defragment = false;  // repack uploaded subtextures when an insertion fails due to fragmentation
+	bool relocation_pending = false;
+	bool relocated = false;  // set when subtextures moved, reset by the owner after patching its references
 	InPlaceArray<PixelBufferComponent> textures
 			= InPlaceArray<PixelBufferComponent>(BUFFER_MAXIMUM_TEXTURE_COUNT);
 	std::mutex mutex_texture_requests;
-	queue<TextureData> load_requests;
+	queue<AtlasUpload> load_requests;
+	queue<AtlasMipUpdate> mip_requests;
 	ThreadSignal signal;
 };
 
@@ -167,14 +383,17 @@ class Framebuffer
 public:
 	Framebuffer(u8 compcount);
 	void define_colour_component(u8 index,f32 width,f32 height,bool fbuffer=false);
-	void define_depth_component(f32 width,f32 height);
+	void define_colour_component(u8 index,f32 width,f32 height,GLenum internal,GLenum format,GLenum type);
+	void define_depth_component(f32 width,f32 height,GLenum internal=GL_DEPTH_COMPONENT);
 	void finalize();
 
 	// usage
 	void start();
+	void bind();
 	static void stop();
 	void bind_colour_component(u8 channel,u8 i);
 	void bind_depth_component(u8 channel);
+	void blit_depth_component(Framebuffer& target,u32 width,u32 height);
 
 private:
 	u32 m_Buffer;
@@ -9,16 +9,48 @@
 
 #define BUFFER_MAXIMUM_TEXTURE_COUNT 1024
 #define BUFFER_ATLAS_BORDER_PADDING 32
+#define BUFFER_TEXTURE_CACHE_EXTENSION ".ktx"
+#define BUFFER_UPLOAD_RING_SLOTS 4
+#define BUFFER_UPLOAD_SLOT_SIZE 0x400000
+#define BUFFER_FONT_SDF_SIZE 32
+#define BUFFER_FONT_SDF_SPREAD 6
 
 // renderer
 #define RENDERER_SPRITE_MEMORY_WIDTH 2500
 #define RENDERER_SPRITE_MEMORY_HEIGHT 2500
-#define RENDERER_FONT_MEMORY_WIDTH 2500
-#define RENDERER_FONT_MEMORY_HEIGHT 2500
+#define RENDERER_FONT_MEMORY_WIDTH 2048
+#define RENDERER_FONT_MEMORY_HEIGHT 2048
 #define RENDERER_MAXIMUM_TEXTURE_COUNT 2048
-#define RENDERER_MAXIMUM_FONT_COUNT 2
-#define RENDERER_SHADOW_RESOLUTION 10000
+#define RENDERER_GLYPH_CACHE_OCCUPANCY .9f
+#define RENDERER_GLYPH_CACHE_TARGET .75f
+#define RENDERER_TEXT_FORMAT_CAPACITY 256
+#define RENDERER_SHADOW_RESOLUTION 2048
+#define RENDERER_SHADOW_CASCADES 4
 #define RENDERER_SHADOW_RANGE 150
+#define RENDERER_SHADOW_SPLIT_WEIGHT .75f
+#define RENDERER_VERTEX_CACHE_SIZE 32
+#define RENDERER_MESH_LOD_LEVELS 4
+#define RENDERER_LOD_PIXEL_ERROR 1.f
+#define RENDERER_LOD_HYSTERESIS .25f
+#define RENDERER_LOD_SHADOW_BIAS 1
+#define RENDERER_MESH_CACHE_EXTENSION ".mesh"
+#define RENDERER_TEXTURE_STREAM_RESIDENT 64
+#define RENDERER_TEXTURE_STREAM_BUDGET 0x400000
+#define RENDERER_LIGHT_CLUSTERS_X 16
+#define RENDERER_LIGHT_CLUSTERS_Y 9
+#define RENDERER_LIGHT_CLUSTERS_Z 24
+#define RENDERER_LIGHT_CUTOFF .01f
+#define RENDERER_GBUFFER_NORMAL_FORMAT GL_RG16
+#define RENDERER_GBUFFER_DEPTH_FORMAT GL_DEPTH_COMPONENT24
+#define RENDERER_RESOLUTION_SCALE_MINIMUM .5f
+#define RENDERER_RESOLUTION_SCALE_STEP .05f
+#define RENDERER_RESOLUTION_HEADROOM .85f
+#define RENDERER_RESOLUTION_SMOOTHING .1f
+#define RENDERER_FRAME_QUERIES 3
+
+// loader
+#define LOADER_WORKER_LIMIT 4
+#define LOADER_MEMORY_BUDGET 0x10000000
 
 // network
 #define NETWORK_HOST "ec2-18-196-124-42.eu-central-1.compute.amazonaws.com"
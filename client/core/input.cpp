@@ -41,7 +41,11 @@ void Input::update(bool& running)
 			// text input
 			if (!SDL_IsTextInputActive()) break;
 			if (m_Event.key.keysym.scancode==SDL_SCANCODE_BACKSPACE&&!m_TextBuffer->empty())
+			{
+				// remove all bytes of the last utf-8 encoded codepoint
+				while (m_TextBuffer->size()>1&&(m_TextBuffer->back()&0xc0)==0x80) m_TextBuffer->pop_back();
 				m_TextBuffer->pop_back();
+			}
 			break;
 		case SDL_KEYUP: keyboard.keys.unset(m_Event.key.keysym.scancode);
 			break;
@@ -0,0 +1,162 @@
+#include "loader.h"
+
+
+/**
+ *	queue asset load for the worker pool
+ *	\param load: loading procedure, runs on a worker thread
+ *	\param cancel: procedure replacing the load when cancelled before it started, can be empty
+ *	\param owner: requester identity, used to cancel all of its pending tasks
+ *	\param memory: estimated decoded memory of the asset, in bytes
+ *	\param priority: load order category
+ *	\returns task handle, to wait for or cancel the task
+ *	NOTE workers are started with the first submission
+ */
+LoaderHandle AssetLoader::submit(std::function<void()> load,std::function<void()> cancel,void* owner,
+								 size_t memory,LoaderPriority priority)
+{
+	LoaderHandle __Task = std::make_shared<LoaderTask>();
+	__Task->load = load;
+	__Task->cancel = cancel;
+	__Task->owner = owner;
+	__Task->memory = memory;
+	__Task->priority = priority;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (!m_Workers.size()) _start();
+		__Task->sequence = m_Sequence++;
+		m_Queue.push_back(__Task);
+		std::push_heap(m_Queue.begin(),m_Queue.end(),_later);
+	}
+	m_TaskSignal.notify_one();
+	return __Task;
+}
+
+/**
+ *	cancel task, if it did not start loading yet
+ *	\param handle: task handle
+ *	\returns true if the task has been cancelled, false if it is already loading or done
+ */
+bool AssetLoader::cancel(LoaderHandle handle)
+{
+	u8 __Queued = LOADER_STATE_QUEUED;
+	if (!handle->state.compare_exchange_strong(__Queued,LOADER_STATE_CANCELLED)) return false;
+	if (handle->cancel) handle->cancel();
+
+	// pass the queue lock once, so the state change can not slip between check & wait of a waiting thread
+	{ std::lock_guard<std::mutex> lock(m_Mutex); }
+	m_TaskSignal.notify_all();
+	m_FinishSignal.notify_all();
+	return true;
+}
+
+/**
+ *	cancel all pending tasks of a requester
+ *	\param owner: requester identity, as given at submission
+ *	\returns amount of cancelled tasks
+ *	NOTE cancelled tasks remain in the queue until a worker reaches them, they do not count against the budget
+ */
+u32 AssetLoader::cancel(void* owner)
+{
+	vector<LoaderHandle> __Owned;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		for (LoaderHandle& p_Task : m_Queue)
+		{
+			if (p_Task->owner==owner) __Owned.push_back(p_Task);
+		}
+	}
+
+	// cancel outside of the queue lock, cancellation procedures might submit or wait
+	u32 __Cancelled = 0;
+	for (LoaderHandle& p_Task : __Owned) __Cancelled += cancel(p_Task);
+	return __Cancelled;
+}
+
+/**
+ *	block until task has been loaded or cancelled
+ *	\param handle: task handle
+ */
+void AssetLoader::wait(LoaderHandle handle)
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_FinishSignal.wait(lock,[handle]{ return handle->state>=LOADER_STATE_DONE; });
+}
+
+/**
+ *	cancel all queued tasks & join workers, tasks which are already loading are finished
+ */
+void AssetLoader::exit()
+{
+	vector<LoaderHandle> __Queue;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Running = false;
+		__Queue.swap(m_Queue);
+	}
+	for (LoaderHandle& p_Task : __Queue) cancel(p_Task);
+	m_TaskSignal.notify_all();
+	for (thread& p_Worker : m_Workers) p_Worker.join();
+	m_Workers.clear();
+}
+
+/**
+ *	spawn worker pool, one worker per hardware thread besides the main thread, capped by LOADER_WORKER_LIMIT
+ *	NOTE queue mutex has to be locked by the caller
+ */
+void AssetLoader::_start()
+{
+	u32 __Workers = glm::clamp(thread::hardware_concurrency(),2u,(u32)LOADER_WORKER_LIMIT+1)-1;
+	COMM_LOG("starting asset loader with %u workers",__Workers);
+	for (u32 i=0;i<__Workers;i++) m_Workers.push_back(thread(&AssetLoader::_work,this));
+}
+
+/**
+ *	worker procedure, loads queued tasks while their decoded memory fits the budget
+ *	NOTE a task exceeding the budget on its own is still loaded, as soon as no other task is in flight
+ */
+void AssetLoader::_work()
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	while (true)
+	{
+		// wait for a task that is cancelled or fits into the memory budget
+		m_TaskSignal.wait(lock,[this]
+		{
+			if (!m_Running||!m_Queue.size()) return !m_Running;
+			LoaderHandle& p_Next = m_Queue.front();
+			return p_Next->state==LOADER_STATE_CANCELLED||!m_MemoryInFlight
+					||m_MemoryInFlight+p_Next->memory<=LOADER_MEMORY_BUDGET;
+		});
+		if (!m_Running) return;
+		std::pop_heap(m_Queue.begin(),m_Queue.end(),_later);
+		LoaderHandle __Task = m_Queue.back();
+		m_Queue.pop_back();
+
+		// skip cancelled tasks
+		u8 __Queued = LOADER_STATE_QUEUED;
+		if (!__Task->state.compare_exchange_strong(__Queued,LOADER_STATE_LOADING)) continue;
+
+		// load without holding the queue
+		m_MemoryInFlight += __Task->memory;
+		lock.unlock();
+		__Task->load();
+		lock.lock();
+		m_MemoryInFlight -= __Task->memory;
+		__Task->state = LOADER_STATE_DONE;
+
+		// released memory might allow waiting workers to proceed
+		m_TaskSignal.notify_all();
+		m_FinishSignal.notify_all();
+	}
+}
+
+/**
+ *	heap order of tasks
+ *	\param a: first task
+ *	\param b: second task
+ *	\returns true if a has to be loaded after b
+ */
+bool AssetLoader::_later(const LoaderHandle& a,const LoaderHandle& b)
+{
+	return (a->priority!=b->priority) ? a->priority>b->priority : a->sequence>b->sequence;
+}
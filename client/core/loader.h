@@ -0,0 +1,65 @@
+#ifndef CORE_LOADER_HEADER
+#define CORE_LOADER_HEADER
+
+
+#include "base.h"
+
+
+// tasks are served in order of priority, equal priorities in order of submission
+enum LoaderPriority : u8
+{
+	LOADER_PRIORITY_INTERFACE,
+	LOADER_PRIORITY_VISIBLE,
+	LOADER_PRIORITY_PREFETCH
+};
+
+enum LoaderState : u8
+{
+	LOADER_STATE_QUEUED,
+	LOADER_STATE_LOADING,
+	LOADER_STATE_DONE,
+	LOADER_STATE_CANCELLED
+};
+
+struct LoaderTask
+{
+	std::function<void()> load;
+	std::function<void()> cancel;  // runs instead of load if cancelled while queued, e.g. to release waiting signals
+	void* owner;  // requester identity, to cancel all of its pending tasks
+	size_t memory;  // estimated decoded memory, reserved against the budget while loading
+	LoaderPriority priority;
+	u64 sequence;
+	std::atomic<u8> state = LOADER_STATE_QUEUED;
+};
+typedef std::shared_ptr<LoaderTask> LoaderHandle;
+
+class AssetLoader
+{
+public:
+	LoaderHandle submit(std::function<void()> load,std::function<void()> cancel,void* owner,size_t memory,
+						LoaderPriority priority);
+	bool cancel(LoaderHandle handle);
+	u32 cancel(void* owner);
+	void wait(LoaderHandle handle);
+	void exit();
+
+private:
+	void _start();
+	void _work();
+	static bool _later(const LoaderHandle& a,const LoaderHandle& b);
+
+private:
+	vector<thread> m_Workers;
+	vector<LoaderHandle> m_Queue;  // binary heap, earliest task at the front
+	std::mutex m_Mutex;
+	std::condition_variable m_TaskSignal;
+	std::condition_variable m_FinishSignal;
+	size_t m_MemoryInFlight = 0;
+	u64 m_Sequence = 0;
+	bool m_Running = true;
+};
+
+inline AssetLoader g_Loader;
+
+
+#endif
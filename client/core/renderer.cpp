@@ -22,6 +22,44 @@ ThreadSignal _sprite_signal
 // ----------------------------------------------------------------------------------------------------
 // Text Component
 
+/**
+ *	format text content, without allocating if it fits the former content's memory
+ *	\param format: printf-style format string
+ *	\param ...: format arguments
+ *	NOTE content is truncated to RENDERER_TEXT_FORMAT_CAPACITY-1 bytes
+ */
+void Text::print(const char* format,...)
+{
+	char __Buffer[RENDERER_TEXT_FORMAT_CAPACITY];
+	va_list __Args;
+	va_start(__Args,format);
+	s32 __Length = vsnprintf(__Buffer,RENDERER_TEXT_FORMAT_CAPACITY,format,__Args);
+	va_end(__Args);
+	data.assign(__Buffer,glm::clamp(__Length,0,RENDERER_TEXT_FORMAT_CAPACITY-1));
+}
+
+/**
+ *	relayout text, if content or layout parameters changed since the last layout
+ *	\returns true if the text has been laid out again
+ */
+bool Text::update()
+{
+	u64 __Hash = hash_fnv1a(data.c_str(),data.size());
+	__Hash = hash_fnv1a(&position,sizeof(vec3),__Hash);
+	__Hash = hash_fnv1a(&scale,sizeof(f32),__Hash);
+	__Hash = hash_fnv1a(&colour,sizeof(vec4),__Hash);
+	__Hash = hash_fnv1a(&alignment.border,sizeof(Rect),__Hash);
+	__Hash = hash_fnv1a(&alignment.align,sizeof(ScreenAlignment),__Hash);
+	u32 __Revision = font->revision;
+	__Hash = hash_fnv1a(&__Revision,sizeof(u32),__Hash);
+	if (__Hash==hash) return false;
+
+	hash = __Hash;
+	align();
+	load_buffer();
+	return true;
+}
+
 /**
  *	dynamically align text content based on content dimensions
  */
@@ -47,20 +85,39 @@ void Text::align()
 
 /**
  *	load instance buffer for text content according to specified font
+ *	NOTE glyphs, which are not rasterized yet, are requested & left empty until the font revision changes
  */
 void Text::load_buffer()
 {
-	bool reallocate = buffer.capacity()<data.size();
+	// reference the new glyphs before releasing the former ones, so shared glyphs can not be evicted in-between
+	revision = font->revision;
+	vector<Glyph*> __Glyphs;
+	u32 __Byte = 0;
+	while (__Byte<data.size())
+	{
+		Glyph& p_Glyph = font->glyph(decode_utf8(data,__Byte));
+		p_Glyph.references++;
+		__Glyphs.push_back(&p_Glyph);
+	}
+	release();
+	glyphs.swap(__Glyphs);
+	dirty = true;
+
+	bool reallocate = buffer.capacity()<glyphs.size();
 	COMM_LOG_COND(reallocate,"allocating memory for text buffer");
-	buffer.resize(data.size());
+	buffer.resize(glyphs.size());
 
 	// load font information for characters
 	vec3 __Cursor = vec3(offset.x,offset.y,position.z);
-	for (u32 i=0;i<data.size();i++)
+	for (u32 i=0;i<glyphs.size();i++)
 	{
 		TextCharacter& p_Character = buffer[i];
-		PixelBufferComponent& p_Component = font->tex[data[i]-32];
-		Glyph& p_Glyph = font->glyphs[data[i]-32];
+		Glyph& p_Glyph = *glyphs[i];
+		if (!p_Glyph.ready())
+		{
+			p_Character = {  };
+			continue;
+		}
 
 		// load text data
 		p_Character = {
@@ -68,139 +125,1110 @@ void Text::load_buffer()
 			.scale = p_Glyph.scale*scale,
 			.bearing = p_Glyph.bearing*scale,
 			.colour = colour,
-			.comp = p_Component
+			.comp = p_Glyph.comp
 		};
 
 		__Cursor.x += p_Glyph.advance*scale;
 	}
 }
 
+/**
+ *	release references to displayed glyphs, unreferenced glyphs become subject to glyph cache eviction
+ */
+void Text::release()
+{
+	u64 __Now = std::chrono::steady_clock::now().time_since_epoch().count();
+	for (Glyph* p_Glyph : glyphs)
+	{
+		p_Glyph->references--;
+		p_Glyph->last_use = __Now;
+	}
+	glyphs.clear();
+}
+
 /**
  *	calculate horizontal character intersection
  *	\param pos: horizontal intersecting pixel position
  *	\returns 0 if end of the word, buffer size if beginning of the word is last intersection and else in-between
+ *	NOTE positions are returned as byte offsets from the end of the utf-8 encoded content
  */
 u32 Text::intersection(f32 pos)
 {
-	u32 i = 0;
-
 	// starting intersection
 	if (!data.size()) return 0;
-	f32 __Cursor = position.x+font->glyphs[data[0]-32].advance*.5*scale;
+	u32 __Start = 0,__End = 0;
+	Glyph* p_Glyph = &font->glyph(decode_utf8(data,__End));
+	f32 __Advance = (p_Glyph->ready()) ? p_Glyph->advance : 0;
+	f32 __Cursor = position.x+__Advance*.5*scale;
 
 	// iterate following characters
-	while (i<data.size()-1&&__Cursor<pos)
+	while (__End<data.size()&&__Cursor<pos)
+	{
+		__Start = __End;
+		p_Glyph = &font->glyph(decode_utf8(data,__End));
+		f32 __Next = (p_Glyph->ready()) ? p_Glyph->advance : 0;
+		__Cursor += (__Advance+__Next)*.5*scale;
+		__Advance = __Next;
+	}
+	return data.size()-__Start;
+}
+
+
+// ----------------------------------------------------------------------------------------------------
+// Geometry Pool
+
+/**
+ *	store elements in buffer memory, reusing released memory ranges first
+ *	\param data: element memory
+ *	\param count: amount of elements
+ *	\param stride: element width in bytes
+ *	\returns offset of the first stored element
+ */
+size_t GeometryPoolMemory::allocate(void* data,size_t count,size_t stride)
+{
+	// first fit into released memory, otherwise append
+	size_t __Offset = this->data.size()/stride;
+	for (u32 i=0;i<free_ranges.size();i++)
+	{
+		GeometryPoolRange& p_Range = free_ranges[i];
+		if (p_Range.count<count) continue;
+		__Offset = p_Range.offset;
+		p_Range.offset += count;
+		p_Range.count -= count;
+		if (!p_Range.count) free_ranges.erase(free_ranges.begin()+i);
+		break;
+	}
+	size_t __Begin = __Offset*stride;
+	size_t __End = __Begin+count*stride;
+	if (__End>this->data.size()) this->data.resize(__End);
+	memcpy(&this->data[__Begin],data,__End-__Begin);
+
+	// extend memory range, which has to be uploaded
+	bool __Clean = dirty_begin==dirty_end;
+	dirty_begin = (__Clean||__Begin<dirty_begin) ? __Begin : dirty_begin;
+	dirty_end = (__Clean||__End>dirty_end) ? __End : dirty_end;
+	return __Offset;
+}
+
+/**
+ *	release a range of elements, so following allocations can reuse its memory
+ *	\param offset: offset of the first released element
+ *	\param count: amount of released elements
+ */
+void GeometryPoolMemory::release(size_t offset,size_t count)
+{
+	// insert released range by offset & merge with adjacent ranges
+	u32 i = 0;
+	while (i<free_ranges.size()&&free_ranges[i].offset<offset) i++;
+	free_ranges.insert(free_ranges.begin()+i,{ offset,count });
+	if (i+1<free_ranges.size()&&free_ranges[i].offset+free_ranges[i].count==free_ranges[i+1].offset)
+	{
+		free_ranges[i].count += free_ranges[i+1].count;
+		free_ranges.erase(free_ranges.begin()+i+1);
+	}
+	if (i>0&&free_ranges[i-1].offset+free_ranges[i-1].count==free_ranges[i].offset)
+	{
+		free_ranges[i-1].count += free_ranges[i].count;
+		free_ranges.erase(free_ranges.begin()+i);
+	}
+}
+
+/**
+ *	upload changed memory to gpu, the buffer is reallocated when outgrowing its capacity
+ *	\param target: buffer target, the buffer has to be bound to it beforehand
+ *	NOTE vertex arrays reference buffers by name, so reallocation does not invalidate attribute mapping
+ */
+void GeometryPoolMemory::upload(GLenum target)
+{
+	if (dirty_begin==dirty_end) return;
+
+	// grow buffer ahead of time, so following allocations can be uploaded partially
+	if (data.size()>capacity)
+	{
+		capacity = data.size()+(data.size()>>1);
+		glBufferData(target,capacity,nullptr,GL_STATIC_DRAW);
+		dirty_begin = 0;
+		dirty_end = data.size();
+	}
+	glBufferSubData(target,dirty_begin,dirty_end-dirty_begin,&data[dirty_begin]);
+	dirty_begin = dirty_end = 0;
+}
+
+/**
+ *	find or create geometry memory for the vertex layout of a pipeline
+ *	\param shader: pipeline, defining the vertex layout
+ *	\param instanced: geometry is drawn with the per-instance geometry layout
+ *	\returns pointer to layout memory, valid for the lifetime of the pool
+ *	NOTE instanced & non-instanced geometry is kept apart, so vertex arrays never carry foreign instance streams
+ */
+GeometryLayout* GeometryPool::get_layout(ShaderPipeline* shader,bool instanced)
+{
+	GeometryLayout& p_Layout = m_Layouts[hash_fnv1a(&instanced,sizeof(bool),shader->get_vertex_layout())];
+	p_Layout.stride = shader->get_vertex_width();
+
+	// compare to compressed vertex raster, as encoded by the pipeline: (dimension<<8)|format per attribute
+	u16 __CompressedRaster[] = {
+		(3<<8)|SHADER_ATTRIBUTE_HALF,(2<<8)|SHADER_ATTRIBUTE_UNORM16,
+		(3<<8)|SHADER_ATTRIBUTE_SNORM10,(3<<8)|SHADER_ATTRIBUTE_SNORM10
+	};
+	p_Layout.compressed = shader->get_vertex_layout()==hash_fnv1a(__CompressedRaster,sizeof(__CompressedRaster));
+	return &p_Layout;
+}
+
+/**
+ *	store indexed mesh in layout memory or reference an identical mesh, which is already stored
+ *	\param layout: target layout memory
+ *	\param verts: vertex memory, matching the layout raster
+ *	\param size: vertex memory width in bytes
+ *	\param indices: triangle indices, relative to the first vertex of the mesh
+ *	\param isize: amount of indices
+ *	\returns mesh reference, to look up the memory ranges & to release the mesh,
+ *		RENDERER_INVALID_MESH if the geometry does not match the layout
+ */
+u64 GeometryPool::allocate(GeometryLayout* layout,void* verts,size_t size,u32* indices,size_t isize)
+{
+	if (!layout->stride||size%layout->stride)
 	{
-		__Cursor += (font->glyphs[data[i]-32].advance+font->glyphs[data[i+1]-32].advance)*.5*scale;
-		i++;
+		COMM_ERR("[RENDERER] geometry does not match pipeline vertex layout");
+		return RENDERER_INVALID_MESH;
+	}
+
+	// reference identical mesh, rehash on collision. the invalid reference is remapped, collisions are resolved
+	u64 __Hash = hash_fnv1a(indices,isize*sizeof(u32),hash_fnv1a(verts,size));
+	__Hash += __Hash==RENDERER_INVALID_MESH;
+	auto __Match = layout->meshes.find(__Hash);
+	while (__Match!=layout->meshes.end())
+	{
+		GeometryPoolMesh& p_Mesh = __Match->second;
+		if (p_Mesh.vertex_count*layout->stride==size&&p_Mesh.index_count==isize
+			&&!memcmp(&layout->vertices.data[p_Mesh.offset*layout->stride],verts,size)
+			&&!memcmp(&layout->indices.data[p_Mesh.index_offset*sizeof(u32)],indices,isize*sizeof(u32)))
+		{
+			p_Mesh.references++;
+			return __Hash;
+		}
+		__Hash = hash_fnv1a(verts,size,__Hash);
+		__Hash += __Hash==RENDERER_INVALID_MESH;
+		__Match = layout->meshes.find(__Hash);
+	}
+
+	// store geometry
+	size_t __VertexCount = size/layout->stride;
+	layout->meshes[__Hash] = {
+		.offset = layout->vertices.allocate(verts,__VertexCount,layout->stride),
+		.vertex_count = __VertexCount,
+		.index_offset = layout->indices.allocate(indices,isize,sizeof(u32)),
+		.index_count = isize,
+		.references = 1
+	};
+	return __Hash;
+}
+
+/**
+ *	drop a mesh reference, memory of unreferenced meshes is reused by following allocations
+ *	\param layout: layout memory holding the mesh
+ *	\param mesh: mesh reference, as returned when allocating
+ */
+void GeometryPool::release(GeometryLayout* layout,u64 mesh)
+{
+	auto __Match = layout->meshes.find(mesh);
+	if (__Match==layout->meshes.end()||--__Match->second.references) return;
+	GeometryPoolMesh& p_Mesh = __Match->second;
+	layout->vertices.release(p_Mesh.offset,p_Mesh.vertex_count);
+	layout->indices.release(p_Mesh.index_offset,p_Mesh.index_count);
+	layout->meshes.erase(__Match);
+}
+
+/**
+ *	upload changed layout memory to gpu
+ *	NOTE binds the layout vertex arrays, because the element buffer binding is part of their state
+ */
+void GeometryPool::upload()
+{
+	for (auto& p_Pair : m_Layouts)
+	{
+		GeometryLayout& p_Layout = p_Pair.second;
+		if (p_Layout.vertices.dirty_begin==p_Layout.vertices.dirty_end
+			&&p_Layout.indices.dirty_begin==p_Layout.indices.dirty_end) continue;
+		p_Layout.vao.bind();
+		p_Layout.vbo.bind();
+		p_Layout.vertices.upload(GL_ARRAY_BUFFER);
+		p_Layout.ebo.bind_elements();
+		p_Layout.indices.upload(GL_ELEMENT_ARRAY_BUFFER);
 	}
-	return data.size()-i;
 }
 
 
 // ----------------------------------------------------------------------------------------------------
 // Mesh Component
 
+/**
+ *	add weighted plane to quadric
+ *	\param normal: normalized plane normal
+ *	\param distance: plane offset, such that dot(normal,x)+distance=0 for all points x on the plane
+ *	\param weight: plane influence, usually the area of the originating triangle
+ */
+void Quadric::add_plane(vec3 normal,f32 distance,f32 weight)
+{
+	vec4 __Plane = vec4(normal,distance);
+	u8 __Element = 0;
+	for (u8 i=0;i<4;i++)
+	{
+		for (u8 j=i;j<4;j++) q[__Element++] += weight*__Plane[i]*__Plane[j];
+	}
+	this->weight += weight;
+}
+
+/**
+ *	merge planes of another quadric
+ *	\param quadric: quadric to merge
+ */
+void Quadric::add(Quadric& quadric)
+{
+	for (u8 i=0;i<10;i++) q[i] += quadric.q[i];
+	weight += quadric.weight;
+}
+
+/**
+ *	evaluate quadric error at position
+ *	\param position: position to evaluate
+ *	\returns weighted sum of squared distances to all planes
+ */
+f32 Quadric::evaluate(vec3 position)
+{
+	vec4 __Point = vec4(position,1.f);
+	f32 __Error = .0f;
+	u8 __Element = 0;
+	for (u8 i=0;i<4;i++)
+	{
+		__Error += q[__Element++]*__Point[i]*__Point[i];
+		for (u8 j=i+1;j<4;j++) __Error += 2.f*q[__Element++]*__Point[i]*__Point[j];
+	}
+	return glm::max(__Error,.0f);
+}
+
 /**
  *	load mesh geometry from .obj file
  *	\param path: path to .obj file explicitly defining geometry
+ *	NOTE processed geometry is cached next to the source file, later loads map the cache instead of parsing
  */
 Mesh::Mesh(const char* path)
 {
-	vector<vec3> __Positions;
-	vector<vec2> __UVCoordinates;
-	vector<vec3> __Normals;
-	vector<u32> __PositionIndices;
-	vector<u32> __UVIndices;
-	vector<u32> __NormalIndices;
-
-	// open source file
-	FILE* __OBJFile = fopen(path,"r");
-	if (__OBJFile==NULL)
+	// identify source contents
+	MappedFile __Source;
+	if (!__Source.open(path))
 	{
 		COMM_ERR("geometry definition file %s could not be found",path);
 		return;
 	}
+	u64 __SourceHash = hash_fnv1a(__Source.data,__Source.size);
+
+	// processed geometry is still valid
+	string __CachePath = string(path)+RENDERER_MESH_CACHE_EXTENSION;
+	if (_read_cache(__CachePath.c_str(),__SourceHash)) return;
+
+	// index geometry & optimize for vertex cache & fetch locality
+	_load_obj(__Source);
+	__Source.close();
+	_weld();
+	_optimize_triangle_order(indices);
+	_generate_lods();
+	_optimize_vertex_order();
+
+	// bounding volume for visibility tests
+	bounds.fit(vertices.data(),vertices.size(),sizeof(Vertex));
+	_write_cache(__CachePath.c_str(),__SourceHash);
+}
+
+/**
+ *	parse .obj source into unindexed triangle vertices & precalculate their tangents
+ *	the source is split into chunks at line boundaries, which are counted & parsed in parallel. counting first
+ *	allows to presize all lists & to place each chunk's elements at its final location without merging
+ *	\param source: mapped .obj file
+ *	NOTE faces with more than three corners are triangulated as fans, missing uvs default to the origin &
+ *		missing normals to the face normal
+ *	NOTE meshes load within loader workers, so each load only splits into its share of the hardware threads
+ */
+void Mesh::_load_obj(MappedFile& source)
+{
+	// split source into chunks at line boundaries
+	const char* __Cursor = (const char*)source.data;
+	const char* __End = __Cursor+source.size;
+	u32 __ChunkCount = glm::clamp<size_t>(source.size/RENDERER_OBJ_CHUNK_SIZE,1,
+											 glm::max(std::thread::hardware_concurrency()/LOADER_WORKER_LIMIT,1u));
+	vector<ObjChunk> __Chunks(__ChunkCount);
+	for (u32 i=0;i<__ChunkCount;i++)
+	{
+		const char* __ChunkEnd = (i+1<__ChunkCount) ? __Cursor+source.size/__ChunkCount : __End;
+		__ChunkEnd = (__ChunkEnd<__End) ? (const char*)memchr(__ChunkEnd,'\n',__End-__ChunkEnd) : nullptr;
+		__ChunkEnd = (__ChunkEnd==nullptr) ? __End : __ChunkEnd+1;
+		__Chunks[i].begin = __Cursor;
+		__Chunks[i].end = __ChunkEnd;
+		__Cursor = __ChunkEnd;
+	}
+
+	// count elements per chunk
+	vector<std::thread> __Workers;
+	for (ObjChunk& p_Chunk : __Chunks) __Workers.push_back(std::thread(&Mesh::_count_obj_chunk,std::ref(p_Chunk)));
+	for (std::thread& p_Worker : __Workers) p_Worker.join();
+	__Workers.clear();
 
-	// iterate and sort geometry information
-	char __Command[128];
-	while (fscanf(__OBJFile,"%s",__Command)!=EOF)
+	// place chunk elements after the elements of all preceding chunks
+	u32 __Positions = 0, __UVs = 0, __Normals = 0, __Triangles = 0;
+	for (ObjChunk& p_Chunk : __Chunks)
 	{
-		// process position prefix
-		if (!strcmp(__Command,"v"))
+		p_Chunk.position_offset = __Positions;
+		p_Chunk.uv_offset = __UVs;
+		p_Chunk.normal_offset = __Normals;
+		p_Chunk.triangle_offset = __Triangles;
+		__Positions += p_Chunk.positions;
+		__UVs += p_Chunk.uvs;
+		__Normals += p_Chunk.normals;
+		__Triangles += p_Chunk.triangles;
+	}
+
+	// parse elements
+	vector<vec3> __PositionList(__Positions);
+	vector<vec2> __UVList(__UVs);
+	vector<vec3> __NormalList(__Normals);
+	vector<ObjCorner> __Corners(__Triangles*3);
+	for (ObjChunk& p_Chunk : __Chunks)
+		__Workers.push_back(std::thread(&Mesh::_parse_obj_chunk,std::ref(p_Chunk),__PositionList.data(),
+										__UVList.data(),__NormalList.data(),__Corners.data()));
+	for (std::thread& p_Worker : __Workers) p_Worker.join();
+	__Workers.clear();
+
+	// write triangle vertices in even ranges per worker
+	vertices.resize(__Triangles*3);
+	u32 __Range = (__Triangles+__ChunkCount-1)/__ChunkCount;
+	for (u32 i=0;i<__Triangles;i+=__Range)
+		__Workers.push_back(std::thread(&Mesh::_write_triangles,&vertices[i*3],&__Corners[i*3],
+										glm::min(__Range,__Triangles-i),std::ref(__PositionList),
+										std::ref(__UVList),std::ref(__NormalList)));
+	for (std::thread& p_Worker : __Workers) p_Worker.join();
+}
+
+/**
+ *	skip spaces & tabs within a line
+ *	\param cursor: current position in source
+ *	\param end: end of line
+ *	\returns position of the next non-blank character or end of line
+ */
+inline const char* _obj_skip_blanks(const char* cursor,const char* end)
+{
+	while (cursor<end&&(*cursor==' '||*cursor=='\t'||*cursor=='\r')) cursor++;
+	return cursor;
+}
+
+/**
+ *	parse consecutive floats of an .obj element line
+ *	\param cursor: position after the element prefix
+ *	\param end: end of line
+ *	\param values: (output) parsed values, missing values keep their prior contents
+ *	\param count: amount of values to parse
+ */
+inline void _obj_parse_floats(const char* cursor,const char* end,f32* values,u8 count)
+{
+	for (u8 i=0;i<count;i++)
+	{
+		cursor = _obj_skip_blanks(cursor,end);
+		cursor = std::from_chars(cursor,end,values[i]).ptr;
+	}
+}
+
+/**
+ *	count elements of an .obj chunk
+ *	\param chunk: (input/output) chunk range, element counts are written
+ */
+void Mesh::_count_obj_chunk(ObjChunk& chunk)
+{
+	const char* __Cursor = chunk.begin;
+	while (__Cursor<chunk.end)
+	{
+		const char* __LineEnd = (const char*)memchr(__Cursor,'\n',chunk.end-__Cursor);
+		__LineEnd = (__LineEnd==nullptr) ? chunk.end : __LineEnd;
+		const char* __Line = _obj_skip_blanks(__Cursor,__LineEnd);
+		__Cursor = __LineEnd+1;
+		if (__LineEnd-__Line<2) continue;
+
+		// attribute elements
+		if (__Line[0]=='v')
 		{
-			vec3 __Position;
-			fscanf(__OBJFile,"%f %f %f\n",&__Position.x,&__Position.y,&__Position.z);
-			__Positions.push_back(__Position);
+			chunk.positions += __Line[1]==' '||__Line[1]=='\t';
+			chunk.uvs += __Line[1]=='t';
+			chunk.normals += __Line[1]=='n';
+			continue;
 		}
 
-		// process uv coordinate prefix
-		else if (!strcmp(__Command,"vt"))
+		// faces are triangulated as fans, resulting in two triangles less than corners
+		if (__Line[0]!='f'||(__Line[1]!=' '&&__Line[1]!='\t')) continue;
+		u32 __CornerCount = 0;
+		const char* __Word = __Line+1;
+		while ((__Word = _obj_skip_blanks(__Word,__LineEnd))<__LineEnd)
 		{
-			vec2 __UVCoordinate;
-			fscanf(__OBJFile,"%f %f\n",&__UVCoordinate.x,&__UVCoordinate.y);
-			__UVCoordinates.push_back(__UVCoordinate);
+			__CornerCount++;
+			while (__Word<__LineEnd&&*__Word!=' '&&*__Word!='\t'&&*__Word!='\r') __Word++;
 		}
+		chunk.triangles += (__CornerCount>2) ? __CornerCount-2 : 0;
+	}
+}
 
-		// process normal prefix
-		else if (!strcmp(__Command,"vn"))
+/**
+ *	parse elements of an .obj chunk into their final list locations
+ *	\param chunk: counted chunk with element offsets
+ *	\param positions: (output) position list of all chunks
+ *	\param uvs: (output) uv coordinate list of all chunks
+ *	\param normals: (output) normal list of all chunks
+ *	\param corners: (output) triangle corners of all chunks
+ *	NOTE relative indices are resolved against the elements defined so far, including preceding chunks
+ */
+void Mesh::_parse_obj_chunk(ObjChunk& chunk,vec3* positions,vec2* uvs,vec3* normals,ObjCorner* corners)
+{
+	u32 __Position = chunk.position_offset;
+	u32 __UV = chunk.uv_offset;
+	u32 __Normal = chunk.normal_offset;
+	ObjCorner* p_Corner = &corners[chunk.triangle_offset*3];
+	const char* __Cursor = chunk.begin;
+	while (__Cursor<chunk.end)
+	{
+		const char* __LineEnd = (const char*)memchr(__Cursor,'\n',chunk.end-__Cursor);
+		__LineEnd = (__LineEnd==nullptr) ? chunk.end : __LineEnd;
+		const char* __Line = _obj_skip_blanks(__Cursor,__LineEnd);
+		__Cursor = __LineEnd+1;
+		if (__LineEnd-__Line<2) continue;
+
+		// attribute elements
+		if (__Line[0]=='v'&&(__Line[1]==' '||__Line[1]=='\t'))
 		{
-			vec3 __Normal;
-			fscanf(__OBJFile,"%f %f %f\n",&__Normal.x,&__Normal.y,&__Normal.z);
-			__Normals.push_back(__Normal);
+			positions[__Position] = vec3(.0f);
+			_obj_parse_floats(__Line+1,__LineEnd,&positions[__Position++].x,3);
+			continue;
 		}
-
-		// process face prefix
-		else if (!strcmp(__Command,"f"))
+		if (__Line[0]=='v'&&__Line[1]=='t')
+		{
+			uvs[__UV] = vec2(.0f);
+			_obj_parse_floats(__Line+2,__LineEnd,&uvs[__UV++].x,2);
+			continue;
+		}
+		if (__Line[0]=='v'&&__Line[1]=='n')
 		{
-			u32 __PositionIndex[3];
-			u32 __UVIndex[3];
-			u32 __NormalIndex[3];
-			fscanf(
-					__OBJFile,"%u/%u/%u %u/%u/%u %u/%u/%u\n",
-					&__PositionIndex[0],&__UVIndex[0],&__NormalIndex[0],
-					&__PositionIndex[1],&__UVIndex[1],&__NormalIndex[1],
-					&__PositionIndex[2],&__UVIndex[2],&__NormalIndex[2]
-				);
+			normals[__Normal] = vec3(.0f);
+			_obj_parse_floats(__Line+2,__LineEnd,&normals[__Normal++].x,3);
+			continue;
+		}
+		if (__Line[0]!='f'||(__Line[1]!=' '&&__Line[1]!='\t')) continue;
+
+		// parse face corners as position/uv/normal, where uv & normal are optional
+		ObjCorner __First;
+		ObjCorner __Previous;
+		u32 __CornerCount = 0;
+		const char* __Word = __Line+1;
+		while ((__Word = _obj_skip_blanks(__Word,__LineEnd))<__LineEnd)
+		{
+			s32 __Index[3] = { 0,0,0 };
+			u32 __Defined[3] = { __Position,__UV,__Normal };
+			for (u8 i=0;i<3&&__Word<__LineEnd;i++)
+			{
+				__Word = std::from_chars(__Word,__LineEnd,__Index[i]).ptr;
+				if (__Word>=__LineEnd||*__Word!='/') break;
+				__Word++;
+			}
+			while (__Word<__LineEnd&&*__Word!=' '&&*__Word!='\t'&&*__Word!='\r') __Word++;
+
+			// resolve one-based & relative indices, zero marks a missing attribute
 			for (u8 i=0;i<3;i++)
+				__Index[i] = (__Index[i]>0) ? __Index[i]-1 : (__Index[i]<0) ? __Defined[i]+__Index[i] : -1;
+			ObjCorner __Corner = { .position = __Index[0],.uv = __Index[1],.normal = __Index[2] };
+
+			// emit fan triangle
+			if (!__CornerCount) __First = __Corner;
+			else if (__CornerCount>1)
 			{
-				__PositionIndices.push_back(__PositionIndex[i]);
-				__UVIndices.push_back(__UVIndex[i]);
-				__NormalIndices.push_back(__NormalIndex[i]);
+				*p_Corner++ = __First;
+				*p_Corner++ = __Previous;
+				*p_Corner++ = __Corner;
 			}
+			__Previous = __Corner;
+			__CornerCount++;
 		}
 	}
+}
 
-	// close file & allocate memory
-	fclose(__OBJFile);
-	vertices.reserve(__PositionIndices.size());
-
-	// iterate faces & write vertices
-	for (u32 i=0;i<__PositionIndices.size();i+=3)
+/**
+ *	write vertices of parsed triangles & precalculate their tangents
+ *	\param triangles: (output) three vertices per triangle
+ *	\param corners: three corners per triangle
+ *	\param count: amount of triangles
+ *	\param positions: parsed positions
+ *	\param uvs: parsed uv coordinates
+ *	\param normals: parsed normals
+ */
+void Mesh::_write_triangles(Vertex* triangles,ObjCorner* corners,u32 count,vector<vec3>& positions,
+							vector<vec2>& uvs,vector<vec3>& normals)
+{
+	for (u32 i=0;i<count;i++)
 	{
+		Vertex* p_Triangle = &triangles[i*3];
+		ObjCorner* p_Corners = &corners[i*3];
 		for (u8 j=0;j<3;j++)
 		{
-			u32 n = i+j;
-			Vertex __Vertex = {
-				.position = __Positions[__PositionIndices[n]-1],
-				.uv = __UVCoordinates[__UVIndices[n]-1],
-				.normal = __Normals[__NormalIndices[n]-1]
-			};
-			vertices.push_back(__Vertex);
+			s32 __Position = p_Corners[j].position;
+			s32 __UV = p_Corners[j].uv;
+			p_Triangle[j].position = ((u32)__Position<positions.size()) ? positions[__Position] : vec3(.0f);
+			p_Triangle[j].uv = ((u32)__UV<uvs.size()) ? uvs[__UV] : vec2(.0f);
+		}
+
+		// missing normals default to the face normal
+		vec3 __EdgeDelta0 = p_Triangle[1].position-p_Triangle[0].position;
+		vec3 __EdgeDelta1 = p_Triangle[2].position-p_Triangle[0].position;
+		vec3 __FaceNormal = glm::cross(__EdgeDelta0,__EdgeDelta1);
+		f32 __Area = glm::length(__FaceNormal);
+		__FaceNormal = (__Area>.0f) ? __FaceNormal/__Area : vec3(.0f,1.f,.0f);
+		for (u8 j=0;j<3;j++)
+		{
+			s32 __Normal = p_Corners[j].normal;
+			p_Triangle[j].normal = ((u32)__Normal<normals.size()) ? normals[__Normal] : __FaceNormal;
 		}
 
 		// precalculate tangent for gram-schmidt reorthogonalization & normal mapping
-		vec3 __EdgeDelta0 = vertices[i+1].position-vertices[i].position;
-		vec3 __EdgeDelta1 = vertices[i+2].position-vertices[i].position;
-		vec2 __UVDelta0 = vertices[i+1].uv-vertices[i].uv;
-		vec2 __UVDelta1 = vertices[i+2].uv-vertices[i].uv;
+		vec2 __UVDelta0 = p_Triangle[1].uv-p_Triangle[0].uv;
+		vec2 __UVDelta1 = p_Triangle[2].uv-p_Triangle[0].uv;
 		f32 __Factor = 1.f/(__UVDelta0.x*__UVDelta1.y-__UVDelta0.y*__UVDelta1.x);
 		glm::mat2x3 __CombinedEdges = glm::mat2x3(__EdgeDelta0,__EdgeDelta1);
 		vec2 __CombinedUVs = vec2(__UVDelta1.y,-__UVDelta0.y);
 		vec3 __Tangent = __Factor*(__CombinedEdges*__CombinedUVs);
-		__Tangent = glm::normalize(__Tangent);
-		for (u8 j=0;j<3;j++) vertices[i+j].tangent = __Tangent;
+		f32 __Length = glm::length(__Tangent);
+
+		// degenerate uv mapping, choose any direction perpendicular to the normal
+		if (!(__Length>.0f&&__Length<INFINITY))
+		{
+			vec3 __Axis = (glm::abs(__FaceNormal.x)<.9f) ? vec3(1.f,.0f,.0f) : vec3(.0f,1.f,.0f);
+			__Tangent = glm::cross(__FaceNormal,__Axis);
+			__Length = glm::length(__Tangent);
+		}
+		for (u8 j=0;j<3;j++) p_Triangle[j].tangent = __Tangent/__Length;
+	}
+}
+
+/**
+ *	read processed geometry from binary mesh cache
+ *	\param path: path to cache file
+ *	\param source: content hash of the source file
+ *	\returns true if the cache exists and matches source, version & configuration
+ */
+bool Mesh::_read_cache(const char* path,u64 source)
+{
+	MappedFile __Cache;
+	if (!__Cache.open(path)) return false;
+
+	// validate header & file size
+	MeshCacheHeader* p_Header = (MeshCacheHeader*)__Cache.data;
+	bool __Valid = __Cache.size>=sizeof(MeshCacheHeader)
+			&&p_Header->magic==RENDERER_MESH_CACHE_MAGIC&&p_Header->version==RENDERER_MESH_CACHE_VERSION
+			&&p_Header->source_hash==source&&p_Header->lod_limit==RENDERER_MESH_LOD_LEVELS
+			&&__Cache.size==sizeof(MeshCacheHeader)+p_Header->vertex_count*sizeof(Vertex)
+				+p_Header->index_count*sizeof(u32)+p_Header->lod_count*sizeof(LevelOfDetail);
+	if (!__Valid)
+	{
+		COMM_LOG("mesh cache %s is outdated and will be rebuilt",path);
+		return false;
 	}
+
+	// copy geometry straight from mapped memory
+	u8* __Cursor = __Cache.data+sizeof(MeshCacheHeader);
+	Vertex* __Vertices = (Vertex*)__Cursor;
+	vertices.assign(__Vertices,__Vertices+p_Header->vertex_count);
+	__Cursor += p_Header->vertex_count*sizeof(Vertex);
+	u32* __Indices = (u32*)__Cursor;
+	indices.assign(__Indices,__Indices+p_Header->index_count);
+	__Cursor += p_Header->index_count*sizeof(u32);
+	LevelOfDetail* __Levels = (LevelOfDetail*)__Cursor;
+	lods.assign(__Levels,__Levels+p_Header->lod_count);
+	bounds = p_Header->bounds;
+	return true;
+}
+
+/**
+ *	write processed geometry to binary mesh cache
+ *	\param path: path to cache file
+ *	\param source: content hash of the source file
+ *	NOTE the cache is written to a temporary file first & renamed, so concurrent loads never read partial caches
+ */
+void Mesh::_write_cache(const char* path,u64 source)
+{
+	string __TemporaryPath = string(path)+".tmp";
+	FILE* __File = fopen(__TemporaryPath.c_str(),"wb");
+	if (__File==NULL)
+	{
+		COMM_ERR("mesh cache %s could not be written",path);
+		return;
+	}
+
+	// write header & geometry
+	MeshCacheHeader __Header = {
+		.magic = RENDERER_MESH_CACHE_MAGIC,
+		.version = RENDERER_MESH_CACHE_VERSION,
+		.source_hash = source,
+		.vertex_count = (u32)vertices.size(),
+		.index_count = (u32)indices.size(),
+		.lod_count = (u32)lods.size(),
+		.lod_limit = RENDERER_MESH_LOD_LEVELS,
+		.bounds = bounds
+	};
+	bool __Written = fwrite(&__Header,sizeof(MeshCacheHeader),1,__File)==1
+			&&fwrite(vertices.data(),sizeof(Vertex),vertices.size(),__File)==vertices.size()
+			&&fwrite(indices.data(),sizeof(u32),indices.size(),__File)==indices.size()
+			&&fwrite(lods.data(),sizeof(LevelOfDetail),lods.size(),__File)==lods.size();
+	__Written = !fclose(__File)&&__Written;
+
+	// publish cache
+	if (__Written&&!rename(__TemporaryPath.c_str(),path)) return;
+	COMM_ERR("mesh cache %s could not be written",path);
+	remove(__TemporaryPath.c_str());
+}
+
+/**
+ *	append geometry of another mesh
+ *	\param mesh: mesh to append
+ */
+void Mesh::append(Mesh& mesh)
+{
+	u32 __BaseVertex = vertices.size();
+	vertices.insert(vertices.end(),mesh.vertices.begin(),mesh.vertices.end());
+
+	// merge levels of detail pairwise, levels only one of the meshes has are dropped
+	vector<u32> __Merged;
+	vector<LevelOfDetail> __Levels;
+	u8 __LevelCount = glm::min(lods.size(),mesh.lods.size());
+	for (u8 i=0;i<__LevelCount;i++)
+	{
+		LevelOfDetail& p_Level = lods[i];
+		LevelOfDetail& p_Appended = mesh.lods[i];
+		__Levels.push_back({
+				.index_offset = (u32)__Merged.size(),
+				.index_count = p_Level.index_count+p_Appended.index_count,
+				.error = glm::max(p_Level.error,p_Appended.error)
+			});
+		__Merged.insert(__Merged.end(),indices.begin()+p_Level.index_offset,
+						indices.begin()+p_Level.index_offset+p_Level.index_count);
+		for (u32 j=0;j<p_Appended.index_count;j++)
+			__Merged.push_back(__BaseVertex+mesh.indices[p_Appended.index_offset+j]);
+	}
+	indices.swap(__Merged);
+	lods.swap(__Levels);
+	bounds.fit(vertices.data(),vertices.size(),sizeof(Vertex));
+}
+
+/**
+ *	write mesh vertices in compressed format
+ *	\param data: (output) compressed vertices, in the same order as the mesh vertices
+ *	NOTE uv coordinates are clamped to [0,1], repetition is expected to be handled by texel scaling
+ */
+void Mesh::compress(vector<CompressedVertex>& data)
+{
+	data.resize(vertices.size());
+	for (u32 i=0;i<vertices.size();i++)
+	{
+		Vertex& p_Vertex = vertices[i];
+		data[i] = {
+			.position_xy = glm::packHalf2x16(vec2(p_Vertex.position.x,p_Vertex.position.y)),
+			.position_z = glm::packHalf2x16(vec2(p_Vertex.position.z,.0f)),
+			.uv = glm::packUnorm2x16(p_Vertex.uv),
+			.normal = glm::packSnorm3x10_1x2(vec4(p_Vertex.normal,.0f)),
+			.tangent = glm::packSnorm3x10_1x2(vec4(p_Vertex.tangent,.0f))
+		};
+	}
+}
+
+/**
+ *	merge vertices with equal position, uv & normal and write triangle indices
+ *	NOTE tangents of merged vertices are averaged, they are reorthogonalized when drawing
+ */
+void Mesh::_weld()
+{
+	size_t __KeyWidth = offsetof(Vertex,tangent);
+	vector<Vertex> __Welded;
+	map<u64,u32> __Lookup;
+	indices.resize(vertices.size());
+	for (u32 i=0;i<vertices.size();i++)
+	{
+		Vertex& p_Vertex = vertices[i];
+
+		// find equal vertex, rehash on collision
+		u64 __Hash = hash_fnv1a(&p_Vertex,__KeyWidth);
+		auto __Match = __Lookup.find(__Hash);
+		while (__Match!=__Lookup.end()&&memcmp(&__Welded[__Match->second],&p_Vertex,__KeyWidth))
+		{
+			__Hash = hash_fnv1a(&p_Vertex,__KeyWidth,__Hash);
+			__Match = __Lookup.find(__Hash);
+		}
+		if (__Match!=__Lookup.end())
+		{
+			indices[i] = __Match->second;
+			__Welded[__Match->second].tangent += p_Vertex.tangent;
+			continue;
+		}
+
+		// store unique vertex
+		indices[i] = __Welded.size();
+		__Lookup[__Hash] = __Welded.size();
+		__Welded.push_back(p_Vertex);
+	}
+
+	// normalize accumulated tangents
+	for (Vertex& p_Vertex : __Welded)
+	{
+		f32 __Length = glm::length(p_Vertex.tangent);
+		if (__Length>.0f) p_Vertex.tangent /= __Length;
+	}
+	vertices.swap(__Welded);
+}
+
+/**
+ *	generate coarser levels of detail, each halving the triangle count of the previous level
+ *	levels are appended to the index list, so they share the vertices of the full resolution mesh
+ */
+void Mesh::_generate_lods()
+{
+	lods = { { .index_offset = 0,.index_count = (u32)indices.size(),.error = .0f } };
+	vector<u32> __Level = indices;
+	f32 __Error = .0f;
+	for (u8 i=1;i<RENDERER_MESH_LOD_LEVELS;i++)
+	{
+		// errors of consecutive simplifications add up, as every level is simplified from the last
+		f32 __PassError;
+		if (!_simplify(__Level,(__Level.size()/6)*3,__PassError)) break;
+		__Error += __PassError;
+		_optimize_triangle_order(__Level);
+		lods.push_back({ .index_offset = (u32)indices.size(),.index_count = (u32)__Level.size(),.error = __Error });
+		indices.insert(indices.end(),__Level.begin(),__Level.end());
+	}
+	COMM_LOG("generated %zu levels of detail, from %u to %u indices",lods.size(),
+			 lods[0].index_count,lods.back().index_count);
+}
+
+/**
+ *	simplify triangles by quadric error edge collapses, after garland & heckbert
+ *	in each pass the cheapest collapses with disjoint neighbourhoods are applied, vertices are merged into
+ *	existing vertices, so the simplified triangles can reference the same vertex memory
+ *	\param triangles: (input/output) triangle list indices
+ *	\param target: amount of indices to reduce to
+ *	\param error: (output) largest deviation introduced by the collapses, as object space distance
+ *	\returns true if the triangle count has been reduced noticeably
+ *	NOTE vertices on attribute seams & open borders are locked, collapsing them would tear the surface
+ */
+bool Mesh::_simplify(vector<u32>& triangles,u32 target,f32& error)
+{
+	u32 __VertexCount = vertices.size();
+	size_t __InitialCount = triangles.size();
+	error = .0f;
+
+	// vertices sharing a position are handled as one, their position representative is the first of them
+	vector<u32> __Position(__VertexCount);
+	map<u64,u32> __Lookup;
+	for (u32 i=0;i<__VertexCount;i++)
+	{
+		vec3& p_Position = vertices[i].position;
+		u64 __Hash = hash_fnv1a(&p_Position,sizeof(vec3));
+		auto __Match = __Lookup.find(__Hash);
+		while (__Match!=__Lookup.end()&&vertices[__Match->second].position!=p_Position)
+		{
+			__Hash = hash_fnv1a(&p_Position,sizeof(vec3),__Hash);
+			__Match = __Lookup.find(__Hash);
+		}
+		if (__Match!=__Lookup.end())
+		{
+			__Position[i] = __Match->second;
+			continue;
+		}
+		__Position[i] = i;
+		__Lookup[__Hash] = i;
+	}
+
+	// accumulate area weighted triangle planes for every position
+	vector<Quadric> __Quadrics(__VertexCount);
+	for (u32 i=0;i<triangles.size();i+=3)
+	{
+		vec3 __Origin = vertices[triangles[i]].position;
+		vec3 __Normal = glm::cross(vertices[triangles[i+1]].position-__Origin,
+								   vertices[triangles[i+2]].position-__Origin);
+		f32 __Area = glm::length(__Normal);
+		if (__Area<=.0f) continue;
+		__Normal /= __Area;
+		for (u8 j=0;j<3;j++)
+			__Quadrics[__Position[triangles[i+j]]].add_plane(__Normal,-glm::dot(__Normal,__Origin),__Area*.5f);
+	}
+
+	// lock positions referenced by multiple vertices, which are seams between differing uvs or normals
+	vector<bool> __Locked(__VertexCount,false);
+	vector<s64> __Wedge(__VertexCount,-1);
+	for (u32 __Index : triangles)
+	{
+		s64& p_Wedge = __Wedge[__Position[__Index]];
+		if (p_Wedge<0) p_Wedge = __Index;
+		else if (p_Wedge!=__Index) __Locked[__Position[__Index]] = true;
+	}
+
+	// lock open borders & non-manifold edges, which are not used by exactly two triangles
+	map<u64,u32> __EdgeUse;
+	for (u32 i=0;i<triangles.size();i++)
+	{
+		u64 __First = __Position[triangles[i]];
+		u64 __Second = __Position[triangles[(i%3==2) ? i-2 : i+1]];
+		__EdgeUse[(glm::min(__First,__Second)<<32)|glm::max(__First,__Second)]++;
+	}
+	for (auto& p_Edge : __EdgeUse)
+	{
+		if (p_Edge.second==2) continue;
+		__Locked[p_Edge.first>>32] = true;
+		__Locked[p_Edge.first&0xffffffff] = true;
+	}
+
+	// collapse passes
+	vector<u32> __Remap(__VertexCount);
+	vector<bool> __Touched(__VertexCount);
+	vector<EdgeCollapse> __Collapses;
+	while (triangles.size()>target)
+	{
+		// triangle adjacency of each vertex
+		vector<u32> __AdjacencyOffset(__VertexCount+1,0);
+		for (u32 __Index : triangles) __AdjacencyOffset[__Index+1]++;
+		for (u32 i=0;i<__VertexCount;i++) __AdjacencyOffset[i+1] += __AdjacencyOffset[i];
+		vector<u32> __Adjacency(triangles.size());
+		vector<u32> __Cursor(__AdjacencyOffset.begin(),__AdjacencyOffset.end()-1);
+		for (u32 i=0;i<triangles.size();i++) __Adjacency[__Cursor[triangles[i]]++] = i/3;
+
+		// collapse candidates along both directions of every triangle edge, sorted by error
+		__Collapses.clear();
+		for (u32 i=0;i<triangles.size();i++)
+		{
+			u32 __Edge[2] = { triangles[i],triangles[(i%3==2) ? i-2 : i+1] };
+			for (u8 j=0;j<2;j++)
+			{
+				u32 __Source = __Edge[j];
+				u32 __Target = __Edge[j^1];
+				if (__Locked[__Position[__Source]]||__Position[__Source]==__Position[__Target]) continue;
+				Quadric __Merged = __Quadrics[__Position[__Source]];
+				__Merged.add(__Quadrics[__Position[__Target]]);
+				f32 __Error = (__Merged.weight>.0f)
+						? __Merged.evaluate(vertices[__Target].position)/__Merged.weight : .0f;
+				__Collapses.push_back({ .source = __Source,.target = __Target,.error = __Error });
+			}
+		}
+		if (!__Collapses.size()) break;
+		std::sort(__Collapses.begin(),__Collapses.end(),
+				  [](const EdgeCollapse& a,const EdgeCollapse& b) { return a.error<b.error; });
+
+		// apply cheapest collapses, neighbourhoods of collapsed vertices are touched to keep collapses independent
+		for (u32 i=0;i<__VertexCount;i++) __Remap[i] = i;
+		std::fill(__Touched.begin(),__Touched.end(),false);
+		u32 __Triangles = triangles.size()/3;
+		u32 __Collapsed = 0;
+		for (EdgeCollapse& p_Collapse : __Collapses)
+		{
+			if (__Triangles<=target/3) break;
+			if (__Touched[p_Collapse.source]||__Touched[p_Collapse.target]) continue;
+
+			// reject collapses flipping the orientation of a remaining triangle
+			bool __Flipped = false;
+			u32 __Removed = 0;
+			vec3 __TargetPosition = vertices[p_Collapse.target].position;
+			for (u32 j=__AdjacencyOffset[p_Collapse.source];j<__AdjacencyOffset[p_Collapse.source+1];j++)
+			{
+				u32* p_Triangle = &triangles[__Adjacency[j]*3];
+				if (p_Triangle[0]==p_Collapse.target||p_Triangle[1]==p_Collapse.target
+					||p_Triangle[2]==p_Collapse.target)
+				{
+					__Removed++;
+					continue;
+				}
+				vec3 __Corners[3];
+				for (u8 k=0;k<3;k++) __Corners[k] = vertices[p_Triangle[k]].position;
+				vec3 __Normal = glm::cross(__Corners[1]-__Corners[0],__Corners[2]-__Corners[0]);
+				for (u8 k=0;k<3;k++)
+				{
+					if (p_Triangle[k]==p_Collapse.source) __Corners[k] = __TargetPosition;
+				}
+				vec3 __Moved = glm::cross(__Corners[1]-__Corners[0],__Corners[2]-__Corners[0]);
+				__Flipped = __Flipped||glm::dot(__Normal,__Moved)<=.0f;
+			}
+			if (__Flipped) continue;
+
+			// merge source into target
+			__Remap[p_Collapse.source] = p_Collapse.target;
+			__Quadrics[__Position[p_Collapse.target]].add(__Quadrics[__Position[p_Collapse.source]]);
+			error = glm::max(error,(f32)sqrt(p_Collapse.error));
+			for (u32 j=__AdjacencyOffset[p_Collapse.source];j<__AdjacencyOffset[p_Collapse.source+1];j++)
+			{
+				u32* p_Triangle = &triangles[__Adjacency[j]*3];
+				for (u8 k=0;k<3;k++) __Touched[p_Triangle[k]] = true;
+			}
+			__Triangles -= __Removed;
+			__Collapsed++;
+		}
+		if (!__Collapsed) break;
+
+		// rewrite triangles & drop the ones degenerated by collapses
+		size_t __Written = 0;
+		for (u32 i=0;i<triangles.size();i+=3)
+		{
+			u32 __Triangle[3] = { __Remap[triangles[i]],__Remap[triangles[i+1]],__Remap[triangles[i+2]] };
+			if (__Triangle[0]==__Triangle[1]||__Triangle[1]==__Triangle[2]||__Triangle[2]==__Triangle[0]) continue;
+			for (u8 j=0;j<3;j++) triangles[__Written++] = __Triangle[j];
+		}
+		triangles.resize(__Written);
+	}
+	return triangles.size()<__InitialCount*(1.f-RENDERER_MESH_LOD_MIN_REDUCTION);
+}
+
+/**
+ *	reorder triangles for post-transform vertex cache locality, after tom forsyth's linear-speed optimization
+ *	greedily emits the triangle with the highest score, which is the sum of its vertex scores. vertices score
+ *	by their position in a simulated lru cache & by their amount of remaining triangles
+ *	\param triangles: (input/output) triangle list indices
+ */
+void Mesh::_optimize_triangle_order(vector<u32>& triangles)
+{
+	u32 __VertexCount = vertices.size();
+	u32 __TriangleCount = triangles.size()/3;
+
+	// triangle adjacency of each vertex, remaining triangles are kept at the front of the vertex range
+	vector<u32> __Valence(__VertexCount,0);
+	for (u32 __Index : triangles) __Valence[__Index]++;
+	vector<u32> __AdjacencyOffset(__VertexCount+1,0);
+	for (u32 i=0;i<__VertexCount;i++) __AdjacencyOffset[i+1] = __AdjacencyOffset[i]+__Valence[i];
+	vector<u32> __Adjacency(triangles.size());
+	vector<u32> __Cursor(__AdjacencyOffset.begin(),__AdjacencyOffset.end()-1);
+	for (u32 i=0;i<triangles.size();i++) __Adjacency[__Cursor[triangles[i]]++] = i/3;
+
+	// initial scores
+	vector<s32> __CachePosition(__VertexCount,-1);
+	vector<f32> __VertexScore(__VertexCount);
+	for (u32 i=0;i<__VertexCount;i++) __VertexScore[i] = _vertex_cache_score(-1,__Valence[i]);
+	vector<f32> __TriangleScore(__TriangleCount);
+	for (u32 i=0;i<__TriangleCount;i++)
+		__TriangleScore[i] = __VertexScore[triangles[i*3]]+__VertexScore[triangles[i*3+1]]
+				+__VertexScore[triangles[i*3+2]];
+	vector<bool> __Emitted(__TriangleCount,false);
+
+	// emit triangles
+	vector<u32> __Ordered;
+	__Ordered.reserve(triangles.size());
+	u32 __Cache[RENDERER_VERTEX_CACHE_SIZE+3];
+	u32 __CacheSize = 0;
+	s64 __Best = -1;
+	while (__Ordered.size()<triangles.size())
+	{
+		// no candidate in cache, fall back to the best remaining triangle
+		if (__Best<0)
+		{
+			f32 __BestScore = -1.f;
+			for (u32 i=0;i<__TriangleCount;i++)
+			{
+				if (__Emitted[i]||__TriangleScore[i]<=__BestScore) continue;
+				__Best = i;
+				__BestScore = __TriangleScore[i];
+			}
+		}
+
+		// emit triangle & remove it from vertex adjacency
+		u32* p_Triangle = &triangles[__Best*3];
+		__Emitted[__Best] = true;
+		for (u8 i=0;i<3;i++)
+		{
+			u32 __Vertex = p_Triangle[i];
+			__Ordered.push_back(__Vertex);
+			u32* p_Adjacent = &__Adjacency[__AdjacencyOffset[__Vertex]];
+			u32 j = 0;
+			while (p_Adjacent[j]!=__Best) j++;
+			p_Adjacent[j] = p_Adjacent[--__Valence[__Vertex]];
+		}
+
+		// push triangle vertices to the front of the lru cache
+		u32 __Updated[RENDERER_VERTEX_CACHE_SIZE+3] = { p_Triangle[0],p_Triangle[1],p_Triangle[2] };
+		u32 __UpdatedSize = 3;
+		for (u32 i=0;i<__CacheSize;i++)
+		{
+			u32 __Vertex = __Cache[i];
+			if (__Vertex!=p_Triangle[0]&&__Vertex!=p_Triangle[1]&&__Vertex!=p_Triangle[2])
+				__Updated[__UpdatedSize++] = __Vertex;
+		}
+
+		// rescore touched vertices, vertices beyond cache size have been evicted
+		for (u32 i=0;i<__UpdatedSize;i++)
+		{
+			u32 __Vertex = __Updated[i];
+			__CachePosition[__Vertex] = (i<RENDERER_VERTEX_CACHE_SIZE) ? i : -1;
+			__VertexScore[__Vertex] = _vertex_cache_score(__CachePosition[__Vertex],__Valence[__Vertex]);
+		}
+
+		// rescore adjacent triangles & find the best candidate in cache
+		__Best = -1;
+		f32 __BestScore = -1.f;
+		for (u32 i=0;i<__UpdatedSize;i++)
+		{
+			u32 __Vertex = __Updated[i];
+			for (u32 j=0;j<__Valence[__Vertex];j++)
+			{
+				u32 __Triangle = __Adjacency[__AdjacencyOffset[__Vertex]+j];
+				u32* p_Adjacent = &triangles[__Triangle*3];
+				__TriangleScore[__Triangle] = __VertexScore[p_Adjacent[0]]+__VertexScore[p_Adjacent[1]]
+						+__VertexScore[p_Adjacent[2]];
+				if (i>=RENDERER_VERTEX_CACHE_SIZE||__TriangleScore[__Triangle]<=__BestScore) continue;
+				__Best = __Triangle;
+				__BestScore = __TriangleScore[__Triangle];
+			}
+		}
+
+		// commit cache state
+		__CacheSize = (__UpdatedSize<RENDERER_VERTEX_CACHE_SIZE) ? __UpdatedSize : RENDERER_VERTEX_CACHE_SIZE;
+		memcpy(__Cache,__Updated,__CacheSize*sizeof(u32));
+	}
+	triangles.swap(__Ordered);
+}
+
+/**
+ *	reorder vertices by first reference in triangle order, for pre-transform vertex fetch locality
+ *	NOTE unreferenced vertices are removed
+ */
+void Mesh::_optimize_vertex_order()
+{
+	vector<s32> __Remap(vertices.size(),-1);
+	vector<Vertex> __Ordered;
+	__Ordered.reserve(vertices.size());
+	for (u32& p_Index : indices)
+	{
+		if (__Remap[p_Index]<0)
+		{
+			__Remap[p_Index] = __Ordered.size();
+			__Ordered.push_back(vertices[p_Index]);
+		}
+		p_Index = __Remap[p_Index];
+	}
+	vertices.swap(__Ordered);
+}
+
+/**
+ *	score vertex by its simulated cache position & remaining triangles
+ *	\param position: position in lru cache, -1 if not cached
+ *	\param valence: amount of triangles, which still have to be emitted using this vertex
+ *	\returns vertex score, fresh vertices and vertices with few remaining triangles are preferred
+ */
+f32 Mesh::_vertex_cache_score(s32 position,u32 valence)
+{
+	if (!valence) return -1.f;
+
+	// vertices of the last emitted triangle score a fixed amount, to avoid favouring strips
+	f32 __Score = .0f;
+	if (position>=0&&position<3) __Score = RENDERER_VERTEX_CACHE_LAST_TRIANGLE_SCORE;
+	else if (position>=3)
+	{
+		f32 __Decay = 1.f-(position-3)*(1.f/(RENDERER_VERTEX_CACHE_SIZE-3));
+		__Score = pow(__Decay,RENDERER_VERTEX_CACHE_DECAY_POWER);
+	}
+
+	// boost vertices with few remaining triangles, to finish them off
+	return __Score+RENDERER_VERTEX_CACHE_VALENCE_SCALE*pow((f32)valence,-RENDERER_VERTEX_CACHE_VALENCE_POWER);
 }
 
 /**
@@ -211,7 +1239,25 @@ Mesh::Mesh(const char* path)
  */
 u32 GeometryBatch::add_geometry(Mesh& mesh,vector<Texture*>& tex)
 {
-	return add_geometry(&mesh.vertices[0],mesh.vertices.size(),sizeof(Vertex),tex);
+	_resolve_layout();
+	u32 __ID;
+	if (layout->compressed)
+	{
+		// compress mesh for pipelines with compressed vertex layout
+		vector<CompressedVertex> __Compressed;
+		mesh.compress(__Compressed);
+		__ID = add_geometry(&__Compressed[0],__Compressed.size(),sizeof(CompressedVertex),
+							&mesh.indices[0],mesh.indices.size(),tex);
+	}
+	else __ID = add_geometry(&mesh.vertices[0],mesh.vertices.size(),sizeof(Vertex),
+							 &mesh.indices[0],mesh.indices.size(),tex);
+
+	// levels of detail, relative to the pooled index memory
+	GeometryTuple& p_Tuple = object[__ID];
+	u32 __IndexOffset = p_Tuple.lods[0].index_offset;
+	p_Tuple.lods = mesh.lods;
+	for (LevelOfDetail& p_Level : p_Tuple.lods) p_Level.index_offset += __IndexOffset;
+	return __ID;
 }
 
 /**
@@ -221,23 +1267,74 @@ u32 GeometryBatch::add_geometry(Mesh& mesh,vector<Texture*>& tex)
  *	\param ssize: upload dimension !in memory width!
  *	\param tex: multichannel texture data to upload
  *	\returns geometry id
+ *	NOTE vertices are interpreted as triangle list, use the indexed version for welded geometry
  */
 u32 GeometryBatch::add_geometry(void* verts,size_t vsize,size_t ssize,vector<Texture*>& tex)
 {
-	COMM_LOG("uploading geometry batch to gpu");
-	size_t __MemSize = vsize*ssize;
-	size_t __Size = __MemSize/sizeof(f32);
-	geometry.resize(geometry_cursor+__Size);
-	memcpy(&geometry[geometry_cursor],verts,__MemSize);
+	vector<u32> __Indices(vsize);
+	for (u32 i=0;i<vsize;i++) __Indices[i] = i;
+	return add_geometry(verts,vsize,ssize,&__Indices[0],vsize,tex);
+}
 
-	// store geometry information
+/**
+ *	fit bounding volume around batch geometry, compressed positions are decoded first
+ *	\param bounds: (output) bounding volume
+ *	\param verts: vertex memory in the layout format
+ *	\param vsize: amount of vertices
+ *	\param ssize: vertex width in memory
+ *	\param compressed: vertices are in compressed format
+ */
+inline void _fit_bounds(BoundingVolume& bounds,void* verts,size_t vsize,size_t ssize,bool compressed)
+{
+	if (!compressed)
+	{
+		bounds.fit(verts,vsize,ssize);
+		return;
+	}
+	vector<vec3> __Positions(vsize);
+	for (size_t i=0;i<vsize;i++)
+	{
+		CompressedVertex& p_Vertex = *(CompressedVertex*)((u8*)verts+i*ssize);
+		__Positions[i] = vec3(glm::unpackHalf2x16(p_Vertex.position_xy),glm::unpackHalf2x16(p_Vertex.position_z).x);
+	}
+	bounds.fit(&__Positions[0],vsize,sizeof(vec3));
+}
+
+/**
+ *	upload load indexed batch geometry to gpu
+ *	\param verts: single precision floats, explicitly defining geometry
+ *	\param vsize: amount of vertices (this is the pointer length divided by the upload dimension)
+ *	\param ssize: upload dimension !in memory width!
+ *	\param indices: triangle list indices, relative to the first vertex
+ *	\param isize: amount of indices
+ *	\param tex: multichannel texture data to upload
+ *	\returns geometry id
+ *	NOTE geometry not matching the layout is added without triangles, so the returned id remains usable
+ */
+u32 GeometryBatch::add_geometry(void* verts,size_t vsize,size_t ssize,u32* indices,size_t isize,
+								vector<Texture*>& tex)
+{
+	COMM_LOG("storing batch geometry in pool");
+	_resolve_layout();
+	COMM_ERR_COND(ssize!=layout->stride,"[RENDERER] vertex width %lu does not match pipeline layout width %lu",
+				  ssize,layout->stride);
+
+	// repeated geometry references the same pooled mesh, so objects sharing it can be drawn instanced
+	u64 __Mesh = pool->allocate(layout,verts,vsize*ssize,indices,isize);
+	if (__Mesh==RENDERER_INVALID_MESH)
+	{
+		object.push_back({ .lods = { { .index_offset = 0,.index_count = 0,.error = .0f } },.textures = tex });
+		return object.size()-1;
+	}
+	GeometryPoolMesh& p_Mesh = layout->meshes[__Mesh];
 	object.push_back({
-			.offset = offset_cursor,
+			.offset = p_Mesh.offset,
 			.vertex_count = vsize,
-			.textures = tex
+			.lods = { { .index_offset = (u32)p_Mesh.index_offset,.index_count = (u32)isize,.error = .0f } },
+			.textures = tex,
+			.mesh = __Mesh
 		});
-	offset_cursor += vsize;
-	geometry_cursor += __Size;
+	_fit_bounds(object.back().bounds,verts,vsize,ssize,layout->compressed);
 	return object.size()-1;
 }
 
@@ -247,10 +1344,35 @@ u32 GeometryBatch::add_geometry(void* verts,size_t vsize,size_t ssize,vector<Tex
 void GeometryBatch::load()
 {
 	COMM_LOG("uploading geometry information to GPU");
-	vao.bind();
-	vbo.bind();
-	vbo.upload_vertices(geometry);
-	shader->map(RENDERER_TEXTURE_UNMAPPED,&vbo);
+	_resolve_layout();
+	pool->upload();
+	layout->vao.bind();
+	layout->vbo.bind();
+
+	// pipelines declaring the per-instance layout receive transforms through the instance buffer
+	COMM_ERR_COND(shader->get_instance_width()&&!instanced,
+				  "[RENDERER] geometry instance layout has to be mat4 model followed by float texel");
+	shader->map(RENDERER_TEXTURE_UNMAPPED,&layout->vbo,(instanced) ? &layout->ibo : nullptr);
+}
+
+/**
+ *	remove all geometry from batch & release its pooled meshes
+ */
+void GeometryBatch::clear()
+{
+	if (layout==nullptr) return;
+	for (GeometryTuple& p_Tuple : object) pool->release(layout,p_Tuple.mesh);
+	object.clear();
+}
+
+/**
+ *	find pooled geometry memory matching the vertex layout of the batch pipeline
+ */
+void GeometryBatch::_resolve_layout()
+{
+	if (layout!=nullptr) return;
+	instanced = shader->get_instance_width()==sizeof(GeometryInstance);
+	layout = pool->get_layout(&*shader,instanced);
 }
 
 /**
@@ -291,48 +1413,399 @@ void GeometryBatch::attach_uniform(u32 gid,const char* name,vec4* var)
 			.data = &var->x
 		});
 }
-void GeometryBatch::attach_uniform(u32 gid,const char* name,mat4* var)
+void GeometryBatch::attach_uniform(u32 gid,const char* name,mat4* var)
+{
+	object[gid].uploads.push_back({
+			.uloc = shader->get_uniform_location(name),
+			.udim = SHADER_UNIFORM_MAT44,
+			.data = glm::value_ptr(*var)
+		});
+}
+
+/**
+ *	setup particle batch by mesh geometry
+ *	\param mesh: loaded mesh for explicit geometry information
+ *	\param particles: amount of particles
+ */
+void ParticleBatch::load(Mesh& mesh,u32 particles)
+{
+	if (layout==nullptr) layout = pool->get_layout(&*shader,false);
+	if (layout->compressed)
+	{
+		// compress mesh for pipelines with compressed vertex layout
+		vector<CompressedVertex> __Compressed;
+		mesh.compress(__Compressed);
+		load(&__Compressed[0],__Compressed.size(),sizeof(CompressedVertex),&mesh.indices[0],mesh.indices.size(),
+			 particles);
+	}
+	else load(&mesh.vertices[0],mesh.vertices.size(),sizeof(Vertex),&mesh.indices[0],mesh.indices.size(),particles);
+
+	// levels of detail, relative to the pooled index memory
+	u32 __IndexOffset = lods[0].index_offset;
+	lods = mesh.lods;
+	for (LevelOfDetail& p_Level : lods) p_Level.index_offset += __IndexOffset;
+}
+
+/**
+ *	load particle mesh into batch memory
+ *	\param verts: single precision floats, explicitly defining geometry
+ *	\param vsize: amount of vertices (this is the pointer length divided by the upload dimension)
+ *	\param ssize: upload dimension !in memory width!
+ *	\param particles: amount of particles
+ *	NOTE vertices are interpreted as triangle list, use the indexed version for welded geometry
+ */
+void ParticleBatch::load(void* verts,size_t vsize,size_t ssize,u32 particles)
+{
+	vector<u32> __Indices(vsize);
+	for (u32 i=0;i<vsize;i++) __Indices[i] = i;
+	load(verts,vsize,ssize,&__Indices[0],vsize,particles);
+}
+
+/**
+ *	load indexed particle mesh into batch memory
+ *	\param verts: single precision floats, explicitly defining geometry
+ *	\param vsize: amount of vertices (this is the pointer length divided by the upload dimension)
+ *	\param ssize: upload dimension !in memory width!
+ *	\param indices: triangle list indices, relative to the first vertex
+ *	\param isize: amount of indices
+ *	\param particles: amount of particles
+ */
+void ParticleBatch::load(void* verts,size_t vsize,size_t ssize,u32* indices,size_t isize,u32 particles)
+{
+	COMM_LOG("loading particle mesh geometry information");
+	if (layout==nullptr) layout = pool->get_layout(&*shader,false);
+	if (mesh!=RENDERER_INVALID_MESH) pool->release(layout,mesh);
+	mesh = pool->allocate(layout,verts,vsize*ssize,indices,isize);
+	if (mesh==RENDERER_INVALID_MESH)
+	{
+		lods = { { .index_offset = 0,.index_count = 0,.error = .0f } };
+		active_particles = 0;
+		return;
+	}
+	GeometryPoolMesh& p_Mesh = layout->meshes[mesh];
+	vertex_offset = p_Mesh.offset;
+	lods = { { .index_offset = (u32)p_Mesh.index_offset,.index_count = (u32)isize,.error = .0f } };
+	lod = 0;
+	pool->upload();
+
+	// auto-mapping particle shader pipeline, instances remain individual to the batch
+	vao.bind();
+	layout->vbo.bind();
+	layout->ebo.bind_elements();
+	shader->map(RENDERER_TEXTURE_SPRITES,&layout->vbo,&ibo);
+
+	// store geometry information
+	active_particles = particles;
+	_fit_bounds(bounds,verts,vsize,ssize,layout->compressed);
+}
+
+/**
+ *	remove geometry from batch & release its pooled mesh
+ */
+void ParticleBatch::clear()
+{
+	if (mesh==RENDERER_INVALID_MESH) return;
+	pool->release(layout,mesh);
+	mesh = RENDERER_INVALID_MESH;
+	lods.clear();
+	active_particles = 0;
+}
+
+
+// ----------------------------------------------------------------------------------------------------
+// Render Queue
+
+/**
+ *	create render queue
+ *	\param order: (default state) draw order, blended geometry has to be drawn from back to front
+ */
+RenderQueue::RenderQueue(RenderQueueOrder order)
+	: m_Order(order) {  }
+
+/**
+ *	reset queue for a new frame
+ *	\param camera: camera to cull geometry with and to sort geometry from front to back by distance
+ *	\param materials: (default true) bind textures & upload attached uniforms, disable for depth-only passes
+ *	NOTE levels of detail are selected by passes with materials, depth-only passes draw coarser levels of them
+ */
+void RenderQueue::begin(Camera3D& camera,bool materials)
+{
+	m_Commands.clear();
+	m_Materials = materials;
+	m_Frustum = camera.frustum();
+	m_CameraPosition = camera.position;
+	m_CameraFar = camera.far;
+	m_ProjectionScale = projection_scale(camera);
+}
+
+/**
+ *	enqueue all geometry of a batch, which is intersecting the camera frustum
+ *	\param batch: geometry batch
+ *	\param shader: pipeline to draw the geometry with, allows overriding the batch pipeline e.g. for shadows
+ *	\param filter: (default all) restrict enqueued geometry to static or dynamic shadow casters
+ */
+void RenderQueue::add(GeometryBatch& batch,ShaderPipeline* shader,RenderQueueFilter filter)
+{
+	if (batch.layout==nullptr) return;
+
+	// transform bounding spheres into world space
+	m_Spheres.clear();
+	for (GeometryTuple& p_Tuple : batch.object)
+	{
+		mat4& p_Model = p_Tuple.transform.model;
+		f32 __Scale = glm::max(glm::length(vec3(p_Model[0])),
+							   glm::max(glm::length(vec3(p_Model[1])),glm::length(vec3(p_Model[2]))));
+		m_Spheres.push(vec3(p_Model*vec4(p_Tuple.bounds.center,1.f)),p_Tuple.bounds.radius*__Scale);
+	}
+	m_Visible.resize(m_Spheres.size());
+	m_Frustum.cull(m_Spheres,m_Visible.data());
+
+	// enqueue visible geometry
+	bool __Instanced = batch.instanced&&shader->get_instance_width()==sizeof(GeometryInstance);
+	for (u32 i=0;i<batch.object.size();i++)
+	{
+		GeometryTuple& p_Tuple = batch.object[i];
+		if (!m_Visible[i]||(filter!=RENDERER_QUEUE_ALL&&p_Tuple.static_caster!=(filter==RENDERER_QUEUE_STATIC)))
+			continue;
+		u64 __Textures = (m_Materials&&p_Tuple.textures.size())
+				? hash_fnv1a(&p_Tuple.textures[0],p_Tuple.textures.size()*sizeof(Texture*)) : 0;
+		f32 __Distance = glm::length(vec3(m_Spheres.x[i],m_Spheres.y[i],m_Spheres.z[i])-m_CameraPosition);
+
+		// level of detail by projected size, scaled from object space by the bounding sphere transformation
+		u8 __Level = glm::min<u32>(p_Tuple.lod+RENDERER_LOD_SHADOW_BIAS,p_Tuple.lods.size()-1);
+		if (m_Materials)
+		{
+			f32 __Scale = (p_Tuple.bounds.radius>.0f) ? m_Spheres.r[i]/p_Tuple.bounds.radius : 1.f;
+			p_Tuple.lod = select_lod(p_Tuple.lods,p_Tuple.lod,__Scale*m_ProjectionScale/__Distance);
+			__Level = p_Tuple.lod;
+
+			// request texture resolution by projected diameter, the texture spans the geometry once per texel unit
+			f32 __Demand = 2.f*m_Spheres.r[i]*m_ProjectionScale/(__Distance*p_Tuple.texel);
+			for (Texture* p_Texture : p_Tuple.textures) p_Texture->demand = glm::max(p_Texture->demand,__Demand);
+		}
+		LevelOfDetail& p_Level = p_Tuple.lods[__Level];
+
+		m_Commands.push_back({
+				.key = _key(shader,&batch.layout->vao,__Textures,p_Tuple.mesh+__Level,__Distance/m_CameraFar),
+				.shader = shader,
+				.vao = &batch.layout->vao,
+				.tuple = &p_Tuple,
+				.ibo = __Instanced ? &batch.layout->ibo : nullptr,
+				.base_vertex = (u32)p_Tuple.offset,
+				.index_offset = p_Level.index_offset,
+				.index_count = p_Level.index_count
+			});
+	}
+}
+
+/**
+ *	enqueue particle batch as a single instanced draw
+ *	\param batch: particle batch
+ *	\param shader: pipeline to draw the particles with
+ */
+void RenderQueue::add(ParticleBatch& batch,ShaderPipeline* shader)
+{
+	if (!batch.active_particles) return;
+	u8 __Level = (m_Materials) ? batch.lod : glm::min<u32>(batch.lod+RENDERER_LOD_SHADOW_BIAS,batch.lods.size()-1);
+	LevelOfDetail& p_Level = batch.lods[__Level];
+	m_Commands.push_back({
+			.key = _key(shader,&batch.vao,0,0,batch.distance/m_CameraFar),
+			.shader = shader,
+			.vao = &batch.vao,
+			.tuple = nullptr,
+			.ibo = nullptr,
+			.base_vertex = batch.vertex_offset,
+			.index_offset = p_Level.index_offset,
+			.index_count = p_Level.index_count,
+			.instances = batch.active_particles
+		});
+}
+
+/**
+ *	sort enqueued commands by key, using a least significant digit radix sort over bytes
+ *	NOTE passes over bytes that are equal for all keys are skipped, which is common for the high key ranges
+ */
+void RenderQueue::sort()
+{
+	size_t __Count = m_Commands.size();
+	if (!__Count) return;
+	m_SortBuffer.resize(__Count);
+	for (u8 __Shift=0;__Shift<64;__Shift+=8)
+	{
+		// digit histogram
+		u32 __Histogram[256] = { 0 };
+		for (RenderCommand& p_Command : m_Commands) __Histogram[(p_Command.key>>__Shift)&0xff]++;
+		if (__Histogram[(m_Commands[0].key>>__Shift)&0xff]==__Count) continue;
+
+		// exclusive prefix sum to bucket offsets & scatter
+		u32 __Offset = 0;
+		for (u16 i=0;i<256;i++)
+		{
+			u32 __Bucket = __Histogram[i];
+			__Histogram[i] = __Offset;
+			__Offset += __Bucket;
+		}
+		for (RenderCommand& p_Command : m_Commands)
+			m_SortBuffer[__Histogram[(p_Command.key>>__Shift)&0xff]++] = p_Command;
+		m_Commands.swap(m_SortBuffer);
+	}
+}
+
+/**
+ *	issue draw calls in queue order, only changing gpu state when it differs from the previous command
+ *	NOTE consecutive commands drawing the same mesh with the same materials are merged into one instanced draw
+ */
+void RenderQueue::draw()
+{
+	ShaderPipeline* p_Shader = nullptr;
+	VertexArray* p_VAO = nullptr;
+	Texture* __BoundTextures[RENDERER_QUEUE_TEXTURE_SLOTS] = { nullptr };
+	bool __CameraOverwritten = false;
+	for (size_t i=0;i<m_Commands.size();i++)
+	{
+		RenderCommand& p_Command = m_Commands[i];
+
+		// pipeline state
+		if (p_Command.shader!=p_Shader)
+		{
+			p_Shader = p_Command.shader;
+			p_Shader->enable();
+			p_Shader->upload_camera();
+			__CameraOverwritten = false;
+		}
+		if (p_Command.vao!=p_VAO)
+		{
+			p_VAO = p_Command.vao;
+			p_VAO->bind();
+		}
+
+		// particle geometry
+		if (p_Command.tuple==nullptr)
+		{
+			glDrawElementsInstancedBaseVertex(GL_TRIANGLES,p_Command.index_count,GL_UNSIGNED_INT,
+											  (void*)(p_Command.index_offset*sizeof(u32)),p_Command.instances,
+											  p_Command.base_vertex);
+			continue;
+		}
+		GeometryTuple& p_Tuple = *p_Command.tuple;
+
+		// material state
+		if (m_Materials)
+		{
+			for (u8 j=0;j<p_Tuple.textures.size();j++)
+			{
+				bool __Tracked = j<RENDERER_QUEUE_TEXTURE_SLOTS;
+				if (__Tracked&&__BoundTextures[j]==p_Tuple.textures[j]) continue;
+				p_Tuple.textures[j]->bind(RENDERER_TEXTURE_UNMAPPED+j);
+				if (__Tracked) __BoundTextures[j] = p_Tuple.textures[j];
+			}
+
+			// attached uniforms might overwrite camera uniforms, restore them for the following geometry
+			if (__CameraOverwritten) p_Shader->upload_camera();
+			for (GeometryUniformUpload& p_Upload : p_Tuple.uploads)
+				p_Shader->upload(p_Upload.uloc,p_Upload.udim,p_Upload.data);
+			__CameraOverwritten = p_Tuple.uploads.size();
+		}
+
+		// instanced geometry, gather transforms of all following commands drawing the same mesh
+		if (p_Command.ibo!=nullptr)
+		{
+			m_Instances.clear();
+			m_Instances.push_back({ p_Tuple.transform.model,p_Tuple.texel });
+			while (i+1<m_Commands.size()&&_instanceable(p_Command,m_Commands[i+1]))
+			{
+				GeometryTuple& p_Next = *m_Commands[++i].tuple;
+				m_Instances.push_back({ p_Next.transform.model,p_Next.texel });
+			}
+
+			// orphan instance memory & call gpu
+			p_Command.ibo->bind();
+			p_Command.ibo->upload_vertices(&m_Instances[0],m_Instances.size(),GL_STREAM_DRAW);
+			glDrawElementsInstancedBaseVertex(GL_TRIANGLES,p_Command.index_count,GL_UNSIGNED_INT,
+											  (void*)(p_Command.index_offset*sizeof(u32)),m_Instances.size(),
+											  p_Command.base_vertex);
+			continue;
+		}
+
+		// upload standard values, pipelines expecting instance layout read them from constant attributes
+		if (m_Materials) p_Shader->upload("texel",p_Tuple.texel);
+		p_Shader->upload("model",p_Tuple.transform.model);
+		if (p_Shader->get_instance_width()==sizeof(GeometryInstance))
+		{
+			u32 __Location = p_Shader->get_instance_location();
+			for (u8 j=0;j<4;j++) glVertexAttrib4fv(__Location+j,glm::value_ptr(p_Tuple.transform.model[j]));
+			glVertexAttrib1f(__Location+4,p_Tuple.texel);
+		}
+
+		// call gpu
+		glDrawElementsBaseVertex(GL_TRIANGLES,p_Command.index_count,GL_UNSIGNED_INT,
+								 (void*)(p_Command.index_offset*sizeof(u32)),p_Command.base_vertex);
+	}
+}
+
+/**
+ *	select level of detail by projected geometric error, with hysteresis against flickering between levels
+ *	\param lods: levels of detail, from full resolution to coarsest
+ *	\param current: level selected in the previous frame
+ *	\param pixels: screen pixels covered by one object space unit at the distance of the geometry
+ *	\returns coarsest level with a projected error below RENDERER_LOD_PIXEL_ERROR
+ *	NOTE a coarser level is only chosen, when its error stays below the threshold by the hysteresis margin
+ */
+u8 RenderQueue::select_lod(vector<LevelOfDetail>& lods,u8 current,f32 pixels)
 {
-	object[gid].uploads.push_back({
-			.uloc = shader->get_uniform_location(name),
-			.udim = SHADER_UNIFORM_MAT44,
-			.data = glm::value_ptr(*var)
-		});
+	u8 __Level = glm::min<u32>(current,lods.size()-1);
+	while (__Level&&lods[__Level].error*pixels>RENDERER_LOD_PIXEL_ERROR) __Level--;
+	while (__Level+1u<(u32)lods.size()
+		   &&lods[__Level+1].error*pixels*(1.f+RENDERER_LOD_HYSTERESIS)<RENDERER_LOD_PIXEL_ERROR) __Level++;
+	return __Level;
 }
 
 /**
- *	setup particle batch by mesh geometry
- *	\param mesh: loaded mesh for explicit geometry information
- *	\param particles: amount of particles
+ *	screen pixels covered by one world unit at distance one, used to project geometric error onto the screen
+ *	\param camera: perspective camera
+ *	\returns projection scale, divide by distance to get pixels per unit
  */
-void ParticleBatch::load(Mesh& mesh,u32 particles)
+f32 RenderQueue::projection_scale(Camera3D& camera)
 {
-	load(&mesh.vertices[0],mesh.vertices.size(),sizeof(Vertex),particles);
+	return camera.height*.5f/tan(glm::radians(camera.fov)*.5f);
 }
 
 /**
- *	load particle mesh into batch memory
- *	\param verts: single precision floats, explicitly defining geometry
- *	\param vsize: amount of vertices (this is the pointer length divided by the upload dimension)
- *	\param ssize: upload dimension !in memory width!
- *	\param particles: amount of particles
+ *	compose sort key from draw state
+ *	\param shader: pipeline
+ *	\param vao: vertex array
+ *	\param textures: texture set identity, only the lower bits are used
+ *	\param mesh: mesh identity within the vertex array, only the lower bits are used
+ *	\param depth: normalized distance to camera, clamped to [0,1]
+ *	\returns 64-bit sort key
+ *	NOTE colliding ids only weaken the grouping, state changes are still checked when drawing
+ *	NOTE back to front queues sort by inverted depth first, state only breaks ties between equal depths
  */
-void ParticleBatch::load(void* verts,size_t vsize,size_t ssize,u32 particles)
+u64 RenderQueue::_key(ShaderPipeline* shader,VertexArray* vao,u64 textures,u64 mesh,f32 depth)
 {
-	COMM_LOG("loading particle mesh geometry information");
-	size_t size = vsize*ssize;
-	geometry.resize(size/sizeof(f32));
-	memcpy(&geometry[0],verts,size);
-
-	// auto-mapping particle shader pipeline
-	vao.bind();
-	vbo.bind();
-	vbo.upload_vertices(geometry);
-	shader->map(RENDERER_TEXTURE_SPRITES,&vbo,&ibo);
+	u64 __Depth = (u64)(glm::clamp(depth,.0f,1.f)*RENDERER_QUEUE_DEPTH_MASK);
+	u64 __State = ((shader->get_id()&RENDERER_QUEUE_ID_MASK)<<RENDERER_QUEUE_PIPELINE_SHIFT)
+		|((vao->get_id()&RENDERER_QUEUE_ID_MASK)<<RENDERER_QUEUE_VERTEX_ARRAY_SHIFT)
+		|((textures&RENDERER_QUEUE_TEXTURE_MASK)<<RENDERER_QUEUE_TEXTURE_SHIFT)
+		|((mesh&RENDERER_QUEUE_MESH_MASK)<<RENDERER_QUEUE_MESH_SHIFT);
+	if (m_Order==RENDERER_QUEUE_ORDER_STATE) return __State|__Depth;
+	return ((RENDERER_QUEUE_DEPTH_MASK-__Depth)<<RENDERER_QUEUE_BLENDED_DEPTH_SHIFT)
+		|(__State>>RENDERER_QUEUE_BLENDED_STATE_SHIFT);
+}
 
-	// store geometry information
-	vertex_count = vsize;
-	active_particles = particles;
+/**
+ *	check if a command can be merged into the instanced draw of its predecessor
+ *	\param a: command starting the instanced draw
+ *	\param b: following command
+ *	\returns true if both commands draw the same mesh with the same state
+ *	NOTE geometry with attached uniforms is never merged, because its uniforms have to be uploaded per object
+ */
+bool RenderQueue::_instanceable(RenderCommand& a,RenderCommand& b)
+{
+	return b.tuple!=nullptr&&a.shader==b.shader&&a.vao==b.vao&&a.ibo==b.ibo
+		&&a.base_vertex==b.base_vertex&&a.index_offset==b.index_offset&&a.index_count==b.index_count
+		&&!a.tuple->uploads.size()&&!b.tuple->uploads.size()
+		&&(!m_Materials||a.tuple->textures==b.tuple->textures);
 }
 
 
@@ -349,6 +1822,8 @@ Renderer::Renderer()
 	COMM_LOG("starting font rasterizer");
 	bool _failed = FT_Init_FreeType(&g_FreetypeLibrary);
 	COMM_ERR_COND(_failed,"text rasterizer not available");
+	FT_Int __Spread = BUFFER_FONT_SDF_SPREAD;
+	FT_Property_Set(g_FreetypeLibrary,"sdf","spread",&__Spread);
 
 	COMM_LOG("pre-loading basic geometry data");
 	f32 __QuadVertices[] = {
@@ -385,6 +1860,7 @@ Renderer::Renderer()
 	m_SpriteVertexBuffer.bind();
 	m_SpriteVertexBuffer.upload_vertices(__QuadVertices,24);
 	m_SpritePipeline.map(RENDERER_TEXTURE_SPRITES,&m_SpriteVertexBuffer,&m_SpriteInstanceBuffer);
+	m_SpriteInstanceBuffer.allocate_vertices<SpriteInstance>(BUFFER_MAXIMUM_TEXTURE_COUNT);
 	m_SpritePipeline.upload_coordinate_system();
 
 	COMM_LOG("text pipeline");
@@ -417,6 +1893,7 @@ Renderer::Renderer()
 	m_GPUSpriteTextures.allocate(RENDERER_SPRITE_MEMORY_WIDTH,RENDERER_SPRITE_MEMORY_HEIGHT,GL_RGBA);
 	Texture::set_texture_parameter_linear_mipmap();
 	Texture::set_texture_parameter_clamp_to_edge();
+	m_GPUSpriteTextures.defragment = true;  // fonts are never released, so only the sprite atlas fragments
 
 	COMM_LOG("allocating font memory");
 	m_GPUFontTextures.atlas.bind(RENDERER_TEXTURE_FONTS);
@@ -430,26 +1907,50 @@ Renderer::Renderer()
 	COMM_LOG("creating forward render target");
 	m_ForwardFrameBuffer.start();
 	m_ForwardFrameBuffer.define_colour_component(0,FRAME_RESOLUTION_X,FRAME_RESOLUTION_Y);
-	m_ForwardFrameBuffer.define_depth_component(FRAME_RESOLUTION_X,FRAME_RESOLUTION_Y);
+	m_ForwardFrameBuffer.define_depth_component(FRAME_RESOLUTION_X,FRAME_RESOLUTION_Y,RENDERER_GBUFFER_DEPTH_FORMAT);
 	m_ForwardFrameBuffer.finalize();
 
+	// position is reconstructed from depth, normals are octahedron encoded into two channels.
+	// the nine remaining channels do not fit two RGBA8 targets: metalness rides in the colour alpha,
+	// occlusion in the emission alpha & roughness gets its own single channel target
 	COMM_LOG("creating deferred render target");
 	m_DeferredFrameBuffer.start();
-	m_DeferredFrameBuffer.define_colour_component(0,FRAME_RESOLUTION_X,FRAME_RESOLUTION_Y);
-	m_DeferredFrameBuffer.define_colour_component(1,FRAME_RESOLUTION_X,FRAME_RESOLUTION_Y,true);
-	m_DeferredFrameBuffer.define_colour_component(2,FRAME_RESOLUTION_X,FRAME_RESOLUTION_Y,true);
-	m_DeferredFrameBuffer.define_colour_component(3,FRAME_RESOLUTION_X,FRAME_RESOLUTION_Y,true);
-	m_DeferredFrameBuffer.define_colour_component(4,FRAME_RESOLUTION_X,FRAME_RESOLUTION_Y);
-	m_DeferredFrameBuffer.define_depth_component(FRAME_RESOLUTION_X,FRAME_RESOLUTION_Y);
+	m_DeferredFrameBuffer.define_colour_component(0,FRAME_RESOLUTION_X,FRAME_RESOLUTION_Y,
+												  GL_RGBA8,GL_RGBA,GL_UNSIGNED_BYTE);
+	m_DeferredFrameBuffer.define_colour_component(1,FRAME_RESOLUTION_X,FRAME_RESOLUTION_Y,
+												  RENDERER_GBUFFER_NORMAL_FORMAT,GL_RG,GL_FLOAT);
+	m_DeferredFrameBuffer.define_colour_component(2,FRAME_RESOLUTION_X,FRAME_RESOLUTION_Y,
+												  GL_R8,GL_RED,GL_UNSIGNED_BYTE);
+	m_DeferredFrameBuffer.define_colour_component(3,FRAME_RESOLUTION_X,FRAME_RESOLUTION_Y,
+												  GL_RGBA8,GL_RGBA,GL_UNSIGNED_BYTE);
+	m_DeferredFrameBuffer.define_depth_component(FRAME_RESOLUTION_X,FRAME_RESOLUTION_Y,RENDERER_GBUFFER_DEPTH_FORMAT);
 	m_DeferredFrameBuffer.finalize();
 
 	COMM_LOG("creating shadow projection render target");
 	m_ShadowFrameBuffer.start();
-	m_ShadowFrameBuffer.define_depth_component(RENDERER_SHADOW_RESOLUTION,RENDERER_SHADOW_RESOLUTION);
+	m_ShadowFrameBuffer.define_depth_component(RENDERER_SHADOW_RESOLUTION*RENDERER_SHADOW_CASCADES,
+											   RENDERER_SHADOW_RESOLUTION);
 	Texture::set_texture_parameter_clamp_to_border();
 	Texture::set_texture_parameter_border_colour(vec4(1));
+	m_StaticShadowFrameBuffer.start();
+	m_StaticShadowFrameBuffer.define_depth_component(RENDERER_SHADOW_RESOLUTION*RENDERER_SHADOW_CASCADES,
+													 RENDERER_SHADOW_RESOLUTION);
 	Framebuffer::stop();
 
+	// ----------------------------------------------------------------------------------------------------
+	// Uniform Blocks
+
+	COMM_LOG("allocating uniform blocks");
+	m_CameraUniformBuffer.allocate(&m_CameraBlockState,sizeof(CameraUniformBlock),SHADER_BLOCK_CAMERA);
+	m_LightingUniformBuffer.allocate(&m_LightingBlockState,sizeof(LightingUniformBlock),SHADER_BLOCK_LIGHTING);
+	m_ShadowUniformBuffer.allocate(&m_ShadowBlockState,sizeof(ShadowUniformBlock),SHADER_BLOCK_SHADOW);
+
+	// ----------------------------------------------------------------------------------------------------
+	// Frame Timing
+
+	glGenQueries(RENDERER_FRAME_QUERIES*4,&m_FrameQueries[0][0]);
+	m_FrameStart = std::chrono::steady_clock::now();
+
 	// ----------------------------------------------------------------------------------------------------
 	// Start Subprocesses
 
@@ -470,24 +1971,40 @@ Renderer::Renderer()
  */
 void Renderer::update()
 {
+	_update_resolution();
 	m_FrameStart = std::chrono::steady_clock::now();
+	u32* __Timestamps = m_FrameQueries[m_FrameQueriesIssued%RENDERER_FRAME_QUERIES];
+	m_FrameQueryScales[m_FrameQueriesIssued%RENDERER_FRAME_QUERIES] = m_ResolutionScale;
+	glQueryCounter(__Timestamps[0],GL_TIMESTAMP);
+	_update_shadow_cascades();
+	_update_uniform_blocks();
+	_update_light_clusters();
+	m_GeometryPool.upload();
+
+	// particle visibility, shared by shadow & main passes
+	Frustum __ViewFrustum = g_Camera.frustum();
+	Frustum __ShadowFrustums[RENDERER_SHADOW_CASCADES];
+	for (u8 i=0;i<RENDERER_SHADOW_CASCADES;i++) __ShadowFrustums[i] = m_Lighting.shadow_cascades[i].frustum();
+	_cull_particles(m_ParticleBatches,__ViewFrustum,__ShadowFrustums);
+	_cull_particles(m_DeferredParticleBatches,__ViewFrustum,__ShadowFrustums);
 
 	// shadow projection
 	glCullFace(GL_FRONT);
-	glViewport(0,0,RENDERER_SHADOW_RESOLUTION,RENDERER_SHADOW_RESOLUTION);
-	m_ShadowFrameBuffer.start();
 	_update_shadows(m_ShadowGeometryBatches,m_ShadowParticleBatches);
 	glCullFace(GL_BACK);
 
-	// 3D segment
-	glViewport(0,0,FRAME_RESOLUTION_X,FRAME_RESOLUTION_Y);
+	// 3D segment, at dynamic resolution
+	glQueryCounter(__Timestamps[1],GL_TIMESTAMP);
+	glViewport(0,0,m_ResolutionX,m_ResolutionY);
 	m_ForwardFrameBuffer.start();
-	_update_mesh(m_GeometryBatches,m_ParticleBatches);
+	_update_mesh(m_GeometryBatches,m_ParticleBatches,m_ForwardQueue);
 	m_DeferredFrameBuffer.start();
-	_update_mesh(m_DeferredGeometryBatches,m_DeferredParticleBatches);
+	_update_mesh(m_DeferredGeometryBatches,m_DeferredParticleBatches,m_DeferredQueue);
 	Framebuffer::stop();
+	glQueryCounter(__Timestamps[2],GL_TIMESTAMP);
 
-	// rendertargets
+	// rendertargets, upscaled to the frame
+	glViewport(0,0,FRAME_RESOLUTION_X,FRAME_RESOLUTION_Y);
 	glDisable(GL_DEPTH_TEST);
 	_update_canvas();
 	glEnable(GL_DEPTH_TEST);
@@ -497,7 +2014,11 @@ void Renderer::update()
 	_update_text();
 
 	// end-frame gpu management
+	_update_glyphs();
 	_gpu_upload();
+	glQueryCounter(__Timestamps[3],GL_TIMESTAMP);
+	m_FrameQueriesIssued++;
+	m_CPUFrameTime = calculate_delta_time(m_FrameStart);
 }
 
 /**
@@ -505,23 +2026,33 @@ void Renderer::update()
  */
 void Renderer::exit()
 {
+	g_Loader.exit();
 	_sprite_texture_signal.exit();
 	_sprite_signal.exit();
+	for (Font& p_Font : m_Fonts)
+	{
+		if (p_Font.face) FT_Done_Face(p_Font.face);
+	}
 }
 
 /**
  *	register sprite texture to load and move to sprite pixel buffer
  *	\param path: path to texture file
+ *	\param priority: (default interface) load order category
+ *	\param load: (default nullptr) receives the loader task, to wait for or cancel the load
  *	\returns pointer to texture component info to assign to a sprite later
  */
-PixelBufferComponent* Renderer::register_sprite_texture(const char* path)
+PixelBufferComponent* Renderer::register_sprite_texture(const char* path,LoaderPriority priority,LoaderHandle* load)
 {
 	PixelBufferComponent* p_Comp = m_GPUSpriteTextures.textures.next_free();
 	m_GPUSpriteTextures.signal.stall();
 
+	// cancelled loads still have to release the stalled pixel buffer signal
 	COMM_LOG("sprite texture register of %s",path);
-	thread __LoadThread(GPUPixelBuffer::load_texture,&m_GPUSpriteTextures,p_Comp,path);
-	__LoadThread.detach();
+	LoaderHandle __Task = g_Loader.submit(std::bind(GPUPixelBuffer::load_texture,&m_GPUSpriteTextures,p_Comp,path),
+										  std::bind(&ThreadSignal::proceed,&m_GPUSpriteTextures.signal,false),
+										  p_Comp,TextureData::decoded_size(path),priority);
+	if (load) *load = __Task;
 
 	return p_Comp;
 }
@@ -561,6 +2092,7 @@ Sprite* Renderer::register_sprite(PixelBufferComponent* texture,vec3 position,ve
 		.alpha = alpha,
 	};
 	Renderer::assign_sprite_texture(p_Sprite,texture);
+	update_sprite(p_Sprite);
 	return p_Sprite;
 }
 
@@ -572,8 +2104,11 @@ Sprite* Renderer::register_sprite(PixelBufferComponent* texture,vec3 position,ve
 void Renderer::assign_sprite_texture(Sprite* sprite,PixelBufferComponent* texture)
 {
 	m_GPUSpriteTextures.signal.wait();
+	sprite->texture = texture;
+	if (sprite->tex_position==texture->offset&&sprite->tex_dimension==texture->dimensions) return;
 	sprite->tex_position = texture->offset;
 	sprite->tex_dimension = texture->dimensions;
+	update_sprite(sprite);
 }
 
 /**
@@ -582,15 +2117,16 @@ void Renderer::assign_sprite_texture(Sprite* sprite,PixelBufferComponent* textur
  */
 void Renderer::delete_sprite_texture(PixelBufferComponent* texture)
 {
+	// pending loads are dropped before they claim atlas memory
+	bool __Pending = g_Loader.cancel((void*)texture);
+
 	// signal cleanup
 	texture->offset.x = RENDERER_POSITIONAL_DELETION_CODE;
 	_sprite_texture_signal.proceed();
+	if (__Pending) return;
 
 	// free texture atlas memory
-	m_GPUSpriteTextures.mutex_memory_segments.lock();
-	m_GPUSpriteTextures.memory_segments.push_back(*texture);
-	m_GPUSpriteTextures.mutex_memory_segments.unlock();
-	// TODO merge segments after adding free section to reduce segmentation
+	m_GPUSpriteTextures.release(texture);
 }
 
 /**
@@ -601,23 +2137,30 @@ void Renderer::delete_sprite(Sprite* sprite)
 {
 	sprite->offset.x = RENDERER_POSITIONAL_DELETION_CODE;
 	sprite->scale = vec2(0,0);
+	update_sprite(sprite);
 	sprite = nullptr;
 	_sprite_signal.proceed();
 }
 
 /**
- *	rasterize a vector font and upload pixel buffer to gpu memory
+ *	open a vector font, its glyphs are rasterized as signed distance fields on first use
  *	\param path: path to .ttf vector font file
- *	\param size: rasterization size
- *	\returns font data memory, to use later when writing text with or in style of it
+ *	\param priority: (default interface) load order category
+ *	\param load: (default nullptr) receives the loader task, to wait for or cancel opening the face
+ *	\returns font data memory, to use later when writing text with or in style of it, at any scale
  */
-Font* Renderer::register_font(const char* path,u16 size)
+Font* Renderer::register_font(const char* path,LoaderPriority priority,LoaderHandle* load)
 {
 	COMM_LOG("font register from source %s",path);
-	Font* p_Font = m_Fonts.next_free();
+	m_Fonts.emplace_back();
+	Font* p_Font = &m_Fonts.back();
 	m_GPUFontTextures.signal.stall();
-	thread __LoadThread(GPUPixelBuffer::load_font,&m_GPUFontTextures,p_Font,path,size);
-	__LoadThread.detach();
+
+	// opening the face does not rasterize anything, glyph memory is estimated by the glyph tasks
+	LoaderHandle __Task = g_Loader.submit(std::bind(GPUPixelBuffer::load_font,&m_GPUFontTextures,p_Font,path),
+										  std::bind(&ThreadSignal::proceed,&m_GPUFontTextures.signal,false),
+										  p_Font,0,priority);
+	if (load) *load = __Task;
 	return p_Font;
 }
 
@@ -644,13 +2187,12 @@ lptr<Text> Renderer::write_text(Font* font,string data,vec3 position,f32 scale,v
 		});
 
 	lptr<Text> p_Text = std::prev(m_Texts.end());
-	p_Text->align();
-	p_Text->load_buffer();
+	p_Text->update();
 	return p_Text;
 }
 
 /**
- *	load texture into ram in background and register for vram upload when ready
+ *	load block compressed texture into ram in background and register for vram upload when ready
  *	\param texture: pointer to texture in memory
  *	\param path: path to texture
  *	\param format: texture colour channel format
@@ -661,7 +2203,7 @@ void _load_texture(Texture* texture,const char* path,TextureFormat format,
 				   queue<TextureDataTuple>* data_queue,std::mutex* queue_mutex)
 {
 	TextureData __Data = TextureData(format);
-	__Data.load(path);
+	__Data.load_compressed(path);
 	queue_mutex->lock();
 	data_queue->push(TextureDataTuple{ __Data,texture });
 	queue_mutex->unlock();
@@ -671,15 +2213,20 @@ void _load_texture(Texture* texture,const char* path,TextureFormat format,
  *	load texture into memory
  *	\param path: path to texture file
  *	\param format: (default TEXTURE_FORMAT_RGBA) texture colour channel format
+ *	\param priority: (default visible) load order category, use prefetch for textures that are not yet drawn
+ *	\param load: (default nullptr) receives the loader task, to wait for or cancel the load
  *	\returns pointer to texture in ram, referencing texture in vram
+ *	NOTE a texture, which load was cancelled, stays empty
  */
-Texture* Renderer::register_texture(const char* path,TextureFormat format)
+Texture* Renderer::register_texture(const char* path,TextureFormat format,LoaderPriority priority,LoaderHandle* load)
 {
 	COMM_LOG("mesh texture register of %s",path);
 	Texture* p_Texture = m_MeshTextures.next_free();
 	new(p_Texture) Texture();
-	thread __LoadThread(_load_texture,p_Texture,path,format,&m_MeshTextureUploadQueue,&m_MutexMeshTextureUpload);
-	__LoadThread.detach();
+	LoaderHandle __Task = g_Loader.submit(std::bind(_load_texture,p_Texture,path,format,&m_MeshTextureUploadQueue,
+													&m_MutexMeshTextureUpload),
+										  nullptr,p_Texture,TextureData::decoded_size(path),priority);
+	if (load) *load = __Task;
 	return p_Texture;
 }
 
@@ -704,7 +2251,7 @@ lptr<ShaderPipeline> Renderer::register_pipeline(VertexShader& vs,FragmentShader
  */
 lptr<GeometryBatch> Renderer::register_geometry_batch(lptr<ShaderPipeline> pipeline)
 {
-	m_GeometryBatches.push_back({ .shader = pipeline });
+	m_GeometryBatches.push_back({ .shader = pipeline,.pool = &m_GeometryPool });
 	return std::prev(m_GeometryBatches.end());
 }
 
@@ -714,7 +2261,7 @@ lptr<GeometryBatch> Renderer::register_geometry_batch(lptr<ShaderPipeline> pipel
  */
 lptr<GeometryBatch> Renderer::register_deferred_geometry_batch()
 {
-	m_DeferredGeometryBatches.push_back({ .shader = m_GeometryPassPipeline });
+	m_DeferredGeometryBatches.push_back({ .shader = m_GeometryPassPipeline,.pool = &m_GeometryPool });
 	return std::prev(m_DeferredGeometryBatches.end());
 }
 
@@ -725,7 +2272,7 @@ lptr<GeometryBatch> Renderer::register_deferred_geometry_batch()
  */
 lptr<GeometryBatch> Renderer::register_deferred_geometry_batch(lptr<ShaderPipeline> pipeline)
 {
-	m_DeferredGeometryBatches.push_back({ .shader = pipeline });
+	m_DeferredGeometryBatches.push_back({ .shader = pipeline,.pool = &m_GeometryPool });
 	return std::prev(m_DeferredGeometryBatches.end());
 }
 
@@ -736,7 +2283,7 @@ lptr<GeometryBatch> Renderer::register_deferred_geometry_batch(lptr<ShaderPipeli
  */
 lptr<ParticleBatch> Renderer::register_particle_batch(lptr<ShaderPipeline> pipeline)
 {
-	m_ParticleBatches.push_back({ .shader = pipeline });
+	m_ParticleBatches.push_back({ .shader = pipeline,.pool = &m_GeometryPool });
 	return std::prev(m_ParticleBatches.end());
 }
 
@@ -746,7 +2293,7 @@ lptr<ParticleBatch> Renderer::register_particle_batch(lptr<ShaderPipeline> pipel
  */
 lptr<ParticleBatch> Renderer::register_deferred_particle_batch()
 {
-	m_DeferredParticleBatches.push_back({ .shader = m_ParticlePassPipeline });
+	m_DeferredParticleBatches.push_back({ .shader = m_ParticlePassPipeline,.pool = &m_GeometryPool });
 	return std::prev(m_DeferredParticleBatches.end());
 }
 
@@ -757,10 +2304,54 @@ lptr<ParticleBatch> Renderer::register_deferred_particle_batch()
  */
 lptr<ParticleBatch> Renderer::register_deferred_particle_batch(lptr<ShaderPipeline> pipeline)
 {
-	m_DeferredParticleBatches.push_back({ .shader = pipeline });
+	m_DeferredParticleBatches.push_back({ .shader = pipeline,.pool = &m_GeometryPool });
 	return std::prev(m_DeferredParticleBatches.end());
 }
 
+/**
+ *	remove triangle mesh batch & return its pooled geometry memory
+ *	\param batch: pointer to batch, as returned when registered
+ */
+void Renderer::delete_geometry_batch(lptr<GeometryBatch> batch)
+{
+	batch->clear();
+	m_ShadowGeometryBatches.remove(batch);
+	m_GeometryBatches.erase(batch);
+}
+
+/**
+ *	remove physical mesh batch & return its pooled geometry memory
+ *	\param batch: pointer to batch, as returned when registered
+ */
+void Renderer::delete_deferred_geometry_batch(lptr<GeometryBatch> batch)
+{
+	batch->clear();
+	m_ShadowGeometryBatches.remove(batch);
+	m_DeferredGeometryBatches.erase(batch);
+}
+
+/**
+ *	remove particle batch & return its pooled geometry memory
+ *	\param batch: pointer to batch, as returned when registered
+ */
+void Renderer::delete_particle_batch(lptr<ParticleBatch> batch)
+{
+	batch->clear();
+	m_ShadowParticleBatches.remove(batch);
+	m_ParticleBatches.erase(batch);
+}
+
+/**
+ *	remove physical particle batch & return its pooled geometry memory
+ *	\param batch: pointer to batch, as returned when registered
+ */
+void Renderer::delete_deferred_particle_batch(lptr<ParticleBatch> batch)
+{
+	batch->clear();
+	m_ShadowParticleBatches.remove(batch);
+	m_DeferredParticleBatches.erase(batch);
+}
+
 /**
  *	allow a geometry batch to cast shadows onto the scene
  *	\param b: pointer to casting geometry batch
@@ -782,6 +2373,7 @@ void Renderer::register_shadow_batch(lptr<GeometryBatch> b)
 void Renderer::register_shadow_batch(lptr<ParticleBatch> b)
 {
 	m_ShadowParticleBatches.push_back(b);
+	b->shadow_caster = true;
 	/*
 	b->vao.bind();
 	b->vbo.bind();
@@ -812,64 +2404,41 @@ SunLight* Renderer::add_sunlight(vec3 position,vec3 colour,f32 intensity)
  *	\param constant: constant component in attenuation
  *	\param linear: linear component in attenutation
  *	\param quadratic: quadratic component in attenuation
- *	\returns pointer to pointlight
+ *	\returns pointer to pointlight, remains valid until the lighting is reset
+ *	NOTE the amount of pointlights is unbounded, each pixel only shades the lights of its view cluster
  */
 PointLight* Renderer::add_pointlight(vec3 position,vec3 colour,f32 intensity,f32 constant,
 									 f32 linear,f32 quadratic)
 {
-	m_Lighting.pointlights[m_Lighting.pointlights_active] = {
+	m_PointLights.push_back({
 		.position = position,
 		.colour = colour*intensity,
 		.constant = constant,
 		.linear = linear,
 		.quadratic = quadratic
-	};
-	return &m_Lighting.pointlights[m_Lighting.pointlights_active++];
+	});
+	return &m_PointLights.back();
 }
 
 /**
  *	create a shadow projection source
- *	\param source: position of projection source
+ *	\param source: position of projection source, shadows are cast in direction of the origin
  */
 void Renderer::add_shadow(vec3 source)
 {
-	m_Lighting.shadow_projection = Camera3D(vec3(0),source,RENDERER_SHADOW_RANGE,RENDERER_SHADOW_RANGE,
-											.1f,1000.f);
+	m_Lighting.shadow_source = source;
 }
 // TODO allow for multiple shadows to project at the same time
 // TODO also create support for pointlight shadows
 
 /**
  *	upload all setup lights to gpu lighting simulation processing
+ *	NOTE the lighting block is written at the start of the next frame, only lights that changed are sent
  */
 void Renderer::upload_lighting()
 {
-	m_CanvasPipeline.enable();
-
-	// upload directionlights
-	for (u8 i=0;i<m_Lighting.sunlights_active;i++)
-	{
-		SunLight& light = m_Lighting.sunlights[i];
-		string __ArrayLocation = "sunlights["+std::to_string(i)+"].";
-		m_CanvasPipeline.upload((__ArrayLocation+"position").c_str(),light.position);
-		m_CanvasPipeline.upload((__ArrayLocation+"colour").c_str(),light.colour);
-	}
-	m_CanvasPipeline.upload("sunlights_active",m_Lighting.sunlights_active);
-
-	// upload pointlights
-	for (u8 i=0;i<m_Lighting.pointlights_active;i++)
-	{
-		PointLight& light = m_Lighting.pointlights[i];
-		string __ArrayLocation = "pointlights["+std::to_string(i)+"].";
-		m_CanvasPipeline.upload((__ArrayLocation+"position").c_str(),light.position);
-		m_CanvasPipeline.upload((__ArrayLocation+"colour").c_str(),light.colour);
-		m_CanvasPipeline.upload((__ArrayLocation+"constant").c_str(),light.constant);
-		m_CanvasPipeline.upload((__ArrayLocation+"linear").c_str(),light.linear);
-		m_CanvasPipeline.upload((__ArrayLocation+"quadratic").c_str(),light.quadratic);
-	}
-	m_CanvasPipeline.upload("pointlights_active",m_Lighting.pointlights_active);
+	m_LightingChanged = true;
 }
-// TODO dynamic upload, e.g. when a single light gets updated all the lights need to be uploaded again
 
 /**
  *	deactivate all lights to fundamentally reset the lighting setup
@@ -877,7 +2446,7 @@ void Renderer::upload_lighting()
 void Renderer::reset_lighting()
 {
 	m_Lighting.sunlights_active = 0;
-	m_Lighting.pointlights_active = 0;
+	m_PointLights.clear();
 	upload_lighting();
 }
 
@@ -911,7 +2480,36 @@ void Renderer::_update_sprites()
 {
 	m_SpriteVertexArray.bind();
 	m_SpriteInstanceBuffer.bind();
-	m_SpriteInstanceBuffer.upload_vertices(m_Sprites.mem,BUFFER_MAXIMUM_TEXTURE_COUNT,GL_DYNAMIC_DRAW);
+
+	// upload only modified ranges of active sprite memory
+	u16 i = 0;
+	while (i<m_Sprites.active_range)
+	{
+		if (!m_SpriteDirty[i])
+		{
+			i++;
+			continue;
+		}
+
+		// pack contiguous modified sprites into instance format
+		u16 __RangeStart = i;
+		while (i<m_Sprites.active_range&&m_SpriteDirty[i])
+		{
+			Sprite& p_Sprite = m_Sprites.mem[i];
+			m_SpriteInstances[i] = {
+				.offset = p_Sprite.offset,
+				.scale = p_Sprite.scale,
+				.rotation_alpha = glm::packHalf2x16(vec2(p_Sprite.rotation,p_Sprite.alpha)),
+				.tex_position = glm::packUnorm2x16(p_Sprite.tex_position),
+				.tex_dimension = glm::packUnorm2x16(p_Sprite.tex_dimension)
+			};
+			m_SpriteDirty.unset(i);
+			i++;
+		}
+		m_SpriteInstanceBuffer.upload_vertices_range(&m_SpriteInstances[__RangeStart],__RangeStart,i-__RangeStart);
+	}
+
+	// draw sprites
 	m_SpritePipeline.enable();
 	glDrawArraysInstanced(GL_TRIANGLES,0,6,m_Sprites.active_range);
 }
@@ -926,12 +2524,27 @@ void Renderer::_update_text()
 	m_TextInstanceBuffer.bind();
 	m_TextPipeline.enable();
 
-	// iterate text entities
+	// relayout texts, when glyphs of their font have been rasterized in the meantime
+	bool __Dirty = m_TextDirty;
 	for (Text& p_Text : m_Texts)
 	{
-		m_TextInstanceBuffer.upload_vertices(p_Text.buffer,GL_DYNAMIC_DRAW);
-		glDrawArraysInstanced(GL_TRIANGLES,0,6,p_Text.buffer.size());
+		if (p_Text.revision!=p_Text.font->revision) p_Text.update();
+		__Dirty = __Dirty||p_Text.dirty;
+	}
+
+	// rebuild & upload instances of all texts only when any of them changed, all texts draw at once
+	if (__Dirty)
+	{
+		m_TextInstances.clear();
+		for (Text& p_Text : m_Texts)
+		{
+			m_TextInstances.insert(m_TextInstances.end(),p_Text.buffer.begin(),p_Text.buffer.end());
+			p_Text.dirty = false;
+		}
+		m_TextInstanceBuffer.upload_vertices(m_TextInstances.data(),m_TextInstances.size(),GL_DYNAMIC_DRAW);
+		m_TextDirty = false;
 	}
+	glDrawArraysInstanced(GL_TRIANGLES,0,6,m_TextInstances.size());
 }
 
 /**
@@ -943,18 +2556,21 @@ void Renderer::_update_canvas()
 	m_CanvasPipeline.enable();
 	m_ForwardFrameBuffer.bind_colour_component(RENDERER_TEXTURE_FORWARD,0);
 	m_DeferredFrameBuffer.bind_colour_component(RENDERER_TEXTURE_DEFERRED_COLOUR,0);
-	m_DeferredFrameBuffer.bind_colour_component(RENDERER_TEXTURE_DEFERRED_POSITION,1);
-	m_DeferredFrameBuffer.bind_colour_component(RENDERER_TEXTURE_DEFERRED_NORMAL,2);
-	m_DeferredFrameBuffer.bind_colour_component(RENDERER_TEXTURE_DEFERRED_MATERIAL,3);
-	m_DeferredFrameBuffer.bind_colour_component(RENDERER_TEXTURE_DEFERRED_EMISSION,4);
+	m_DeferredFrameBuffer.bind_colour_component(RENDERER_TEXTURE_DEFERRED_NORMAL,1);
+	m_DeferredFrameBuffer.bind_colour_component(RENDERER_TEXTURE_DEFERRED_MATERIAL,2);
+	m_DeferredFrameBuffer.bind_colour_component(RENDERER_TEXTURE_DEFERRED_EMISSION,3);
 	m_ShadowFrameBuffer.bind_depth_component(RENDERER_TEXTURE_SHADOW_MAP);
 	m_ForwardFrameBuffer.bind_depth_component(RENDERER_TEXTURE_FORWARD_DEPTH);
 	m_DeferredFrameBuffer.bind_depth_component(RENDERER_TEXTURE_DEFERRED_DEPTH);
-	m_CanvasPipeline.upload("camera_position",g_Camera.position);
-	m_CanvasPipeline.upload("shadow_source",m_Lighting.shadow_projection.position);
-	m_CanvasPipeline.upload("shadow_projection",
-							m_Lighting.shadow_projection.proj*m_Lighting.shadow_projection.view);
-	// TODO do this in upload lighting process later
+	m_LightClusterBuffer.bind(RENDERER_TEXTURE_LIGHT_CLUSTERS);
+	m_CanvasPipeline.upload("resolution_scale",vec2(m_ResolutionX*FRAME_RESOLUTION_X_INV,
+													m_ResolutionY*FRAME_RESOLUTION_Y_INV));
+	m_CanvasPipeline.upload("view_projection_inverse",glm::inverse(g_Camera.proj*g_Camera.view));
+	m_CanvasPipeline.upload("cluster_grid",
+							vec3(RENDERER_LIGHT_CLUSTERS_X,RENDERER_LIGHT_CLUSTERS_Y,RENDERER_LIGHT_CLUSTERS_Z));
+	m_CanvasPipeline.upload("cluster_depth",vec2(glm::log(g_Camera.near),
+												 RENDERER_LIGHT_CLUSTERS_Z/glm::log(g_Camera.far/g_Camera.near)));
+	m_CanvasPipeline.upload("cluster_lights",m_LightClusterLightOffset);
 	glDrawArrays(GL_TRIANGLES,0,6);
 }
 
@@ -962,71 +2578,513 @@ void Renderer::_update_canvas()
  *	update triangle meshes
  *	\param gb: geometry batches to draw contained geometry from
  *	\param pb: particle batches to draw contained particles geometry from
+ *	\param queue: render queue to sort the draw submission with
+ */
+void Renderer::_update_mesh(list<GeometryBatch>& gb,list<ParticleBatch>& pb,RenderQueue& queue)
+{
+	queue.begin(g_Camera);
+	for (GeometryBatch& p_Batch : gb) queue.add(p_Batch,&*p_Batch.shader);
+	for (ParticleBatch& p_Batch : pb) queue.add(p_Batch,&*p_Batch.shader);
+	queue.sort();
+	queue.draw();
+}
+
+/**
+ *	draw casting geometry simplified for shadow projection
+ *	\param gb: casting geometry batches for shadow projection
+ *	\param pb: casting particle batches for shadow projection
+ *	NOTE cascades are rendered side by side into the shadow map, each culled to its own casters
  */
-void Renderer::_update_mesh(list<GeometryBatch>& gb,list<ParticleBatch>& pb)
+void Renderer::_update_shadows(list<lptr<GeometryBatch>>& gb,list<lptr<ParticleBatch>>& pb)
 {
-	// iterate static geometry
-	for (GeometryBatch& p_Batch : gb)
+	// detect movement of static casters
+	u64 __StaticHash = hash_fnv1a(nullptr,0);
+	for (lptr<GeometryBatch> p_Batch : gb)
 	{
-		p_Batch.shader->enable();
-		p_Batch.vao.bind();
-		for (GeometryTuple& p_Tuple : p_Batch.object)
+		for (GeometryTuple& p_Tuple : p_Batch->object)
 		{
-			// texture upload
-			for (u8 i=0;i<p_Tuple.textures.size();i++) p_Tuple.textures[i]->bind(RENDERER_TEXTURE_UNMAPPED+i);
+			if (!p_Tuple.static_caster) continue;
+			__StaticHash = hash_fnv1a(&p_Tuple.transform.model,sizeof(mat4),__StaticHash);
+		}
+	}
+	bool __Invalidate = __StaticHash!=m_StaticShadowHash;
+	m_StaticShadowHash = __StaticHash;
 
-			// upload attached uniform value pointers
-			p_Batch.shader->upload_camera();
-			for (GeometryUniformUpload& p_Upload : p_Tuple.uploads)
-				p_Batch.shader->upload(p_Upload.uloc,p_Upload.udim,p_Upload.data);
+	// static casters are only redrawn for cascades that moved since they were cached
+	m_StaticShadowFrameBuffer.bind();
+	glEnable(GL_SCISSOR_TEST);
+	for (u8 i=0;i<RENDERER_SHADOW_CASCADES;i++)
+	{
+		mat4 __Projection = m_Lighting.shadow_cascades[i].proj*m_Lighting.shadow_cascades[i].view;
+		if (!__Invalidate&&__Projection==m_StaticShadowProjections[i]) continue;
+		m_StaticShadowProjections[i] = __Projection;
+		glScissor(i*RENDERER_SHADOW_RESOLUTION,0,RENDERER_SHADOW_RESOLUTION,RENDERER_SHADOW_RESOLUTION);
+		glClear(GL_DEPTH_BUFFER_BIT);
+		_update_shadow_cascade(i,gb,pb,RENDERER_QUEUE_STATIC);
+	}
+	glDisable(GL_SCISSOR_TEST);
+
+	// composite cached static depth & draw moving casters on top
+	m_StaticShadowFrameBuffer.blit_depth_component(m_ShadowFrameBuffer,
+												   RENDERER_SHADOW_RESOLUTION*RENDERER_SHADOW_CASCADES,
+												   RENDERER_SHADOW_RESOLUTION);
+	for (u8 i=0;i<RENDERER_SHADOW_CASCADES;i++) _update_shadow_cascade(i,gb,pb,RENDERER_QUEUE_DYNAMIC);
+}
+
+/**
+ *	draw casters of a single shadow cascade into its region of the bound shadow map
+ *	\param cascade: cascade index
+ *	\param gb: casting geometry batches
+ *	\param pb: casting particle batches, particles are always treated as dynamic casters
+ *	\param filter: static or dynamic casters
+ */
+void Renderer::_update_shadow_cascade(u8 cascade,list<lptr<GeometryBatch>>& gb,list<lptr<ParticleBatch>>& pb,
+									  RenderQueueFilter filter)
+{
+	// TODO geometry uniform upload, this will only be applicable if dynamic shading pipeline is working
+	glViewport(cascade*RENDERER_SHADOW_RESOLUTION,0,RENDERER_SHADOW_RESOLUTION,RENDERER_SHADOW_RESOLUTION);
+	m_GeometryShadowPipeline->enable();
+	m_GeometryShadowPipeline->upload("shadow_cascade",(s32)cascade);
+	m_ParticleShadowPipeline->enable();
+	m_ParticleShadowPipeline->upload("shadow_cascade",(s32)cascade);
+
+	// draw cascade casters
+	m_ShadowQueue.begin(m_Lighting.shadow_cascades[cascade],false);
+	for (lptr<GeometryBatch> p_Batch : gb) m_ShadowQueue.add(*p_Batch,&*m_GeometryShadowPipeline,filter);
+	if (filter!=RENDERER_QUEUE_STATIC)
+		for (lptr<ParticleBatch> p_Batch : pb) m_ShadowQueue.add(*p_Batch,&*m_ParticleShadowPipeline);
+	m_ShadowQueue.sort();
+	m_ShadowQueue.draw();
+}
+
+/**
+ *	fit shadow cascades to slices of the camera frustum
+ *	splits blend logarithmic & uniform distribution by RENDERER_SHADOW_SPLIT_WEIGHT, up to RENDERER_SHADOW_RANGE
+ *	NOTE cascades are fitted by bounding sphere and snapped to texels, so shadows don't shimmer when moving
+ */
+void Renderer::_update_shadow_cascades()
+{
+	// camera frustum corners in world space
+	mat4 __Inverse = glm::inverse(g_Camera.proj*g_Camera.view);
+	vec3 __NearCorners[4];
+	vec3 __FarCorners[4];
+	for (u8 i=0;i<4;i++)
+	{
+		vec2 __Edge = vec2((i&1) ? 1.f : -1.f,(i&2) ? 1.f : -1.f);
+		vec4 __Near = __Inverse*vec4(__Edge,-1.f,1.f);
+		vec4 __Far = __Inverse*vec4(__Edge,1.f,1.f);
+		__NearCorners[i] = vec3(__Near)/__Near.w;
+		__FarCorners[i] = vec3(__Far)/__Far.w;
+	}
+
+	// light orientation
+	vec3 __Direction = glm::normalize(m_Lighting.shadow_source);
+	vec3 __Up = (fabs(__Direction.z)>.99f) ? vec3(0,1,0) : COORDINATE_SYSTEM_ORIENTATION;
 
-			// upload standard values & call gpu
-			p_Batch.shader->upload("model",p_Tuple.transform.model);
-			p_Batch.shader->upload("texel",p_Tuple.texel);
-			glDrawArrays(GL_TRIANGLES,p_Tuple.offset,p_Tuple.vertex_count);
+	// fit cascades
+	f32 __Near = g_Camera.near;
+	f32 __Far = glm::min(g_Camera.far,(f32)RENDERER_SHADOW_RANGE);
+	f32 __SliceStart = __Near;
+	for (u8 i=0;i<RENDERER_SHADOW_CASCADES;i++)
+	{
+		f32 __Progress = (i+1)/(f32)RENDERER_SHADOW_CASCADES;
+		f32 __SliceEnd = RENDERER_SHADOW_SPLIT_WEIGHT*__Near*pow(__Far/__Near,__Progress)
+				+(1.f-RENDERER_SHADOW_SPLIT_WEIGHT)*(__Near+(__Far-__Near)*__Progress);
+
+		// slice corners along frustum edges
+		vec3 __Corners[8];
+		f32 __Start = (__SliceStart-g_Camera.near)/(g_Camera.far-g_Camera.near);
+		f32 __End = (__SliceEnd-g_Camera.near)/(g_Camera.far-g_Camera.near);
+		vec3 __Center = vec3(0);
+		for (u8 j=0;j<4;j++)
+		{
+			vec3 __Edge = __FarCorners[j]-__NearCorners[j];
+			__Corners[j] = __NearCorners[j]+__Edge*__Start;
+			__Corners[j+4] = __NearCorners[j]+__Edge*__End;
+			__Center += __Corners[j]+__Corners[j+4];
 		}
+		__Center /= 8.f;
+
+		// bounding sphere keeps the projection size constant under camera rotation
+		f32 __Radius = .0f;
+		for (u8 j=0;j<8;j++) __Radius = glm::max(__Radius,glm::length(__Corners[j]-__Center));
+		__Radius = ceil(__Radius*16.f)/16.f;
+
+		// orthographic projection, extended towards the source to include casters outside of the slice
+		Camera3D& p_Cascade = m_Lighting.shadow_cascades[i];
+		p_Cascade.position = __Center+__Direction*(__Radius+RENDERER_SHADOW_RANGE);
+		p_Cascade.near = .0f;
+		p_Cascade.far = 2.f*__Radius+RENDERER_SHADOW_RANGE;
+		p_Cascade.view = glm::lookAt(p_Cascade.position,__Center,__Up);
+		p_Cascade.proj = glm::ortho(-__Radius,__Radius,-__Radius,__Radius,p_Cascade.near,p_Cascade.far);
+
+		// snap projection to texel grid
+		vec4 __Origin = p_Cascade.proj*p_Cascade.view*vec4(0,0,0,1)*(RENDERER_SHADOW_RESOLUTION*.5f);
+		vec2 __Snap = (glm::round(vec2(__Origin))-vec2(__Origin))*(2.f/RENDERER_SHADOW_RESOLUTION);
+		p_Cascade.proj[3][0] += __Snap.x;
+		p_Cascade.proj[3][1] += __Snap.y;
+		__SliceStart = __SliceEnd;
 	}
-	// FIXME uploading camera and then afterwards maybe overwrite it is working but it is shite
+}
 
-	// iterate particle geometry
+/**
+ *	compact instances of culled particle batches to those intersecting view or shadow frustum
+ *	\param pb: particle batches, only batches with instances handed over through upload_instances are culled
+ *	\param view: main camera frustum
+ *	\param shadow: shadow cascade frustums, tested for shadow casting batches
+ *	NOTE both passes draw from the same compacted instances, so the buffer is only written once per frame
+ *	NOTE instances share one level of detail per batch, chosen by the most prominent visible instance
+ */
+void Renderer::_cull_particles(list<ParticleBatch>& pb,Frustum& view,Frustum* shadow)
+{
 	for (ParticleBatch& p_Batch : pb)
 	{
-		p_Batch.shader->enable();
-		p_Batch.shader->upload_camera();
-		p_Batch.vao.bind();
-		glDrawArraysInstanced(GL_TRIANGLES,0,p_Batch.vertex_count,p_Batch.active_particles);
+		if (!p_Batch.instance_stride) continue;
+
+		// gather instance bounding spheres
+		m_ParticleSpheres.clear();
+		for (u32 i=0;i<p_Batch.instance_count;i++)
+		{
+			vec3 __Offset;
+			f32 __Scale;
+			u8* __Instance = &p_Batch.instances[i*p_Batch.instance_stride];
+			memcpy(&__Offset,__Instance,sizeof(vec3));
+			memcpy(&__Scale,__Instance+sizeof(vec3),sizeof(f32));
+			m_ParticleSpheres.push(__Offset+p_Batch.bounds.center*__Scale,p_Batch.bounds.radius*__Scale);
+		}
+
+		// visibility, shadow casters stay visible for the shadow projection
+		m_ParticleVisible.resize(p_Batch.instance_count);
+		view.cull(m_ParticleSpheres,m_ParticleVisible.data());
+
+		// level of detail by the instance closest to the camera relative to its size
+		f32 __Prominence = .0f;
+		p_Batch.distance = g_Camera.far;
+		for (u32 i=0;i<p_Batch.instance_count;i++)
+		{
+			if (!m_ParticleVisible[i]) continue;
+			vec3 __Center = vec3(m_ParticleSpheres.x[i],m_ParticleSpheres.y[i],m_ParticleSpheres.z[i]);
+			f32 __Distance = glm::length(__Center-g_Camera.position);
+			__Prominence = glm::max(__Prominence,m_ParticleSpheres.r[i]/__Distance);
+			p_Batch.distance = glm::min(p_Batch.distance,__Distance);
+		}
+		if (p_Batch.bounds.radius>.0f)
+		{
+			f32 __Pixels = __Prominence*RenderQueue::projection_scale(g_Camera)/p_Batch.bounds.radius;
+			p_Batch.lod = RenderQueue::select_lod(p_Batch.lods,p_Batch.lod,__Pixels);
+		}
+		if (p_Batch.shadow_caster)
+		{
+			m_ParticleShadowVisible.resize(p_Batch.instance_count);
+			for (u8 j=0;j<RENDERER_SHADOW_CASCADES;j++)
+			{
+				shadow[j].cull(m_ParticleSpheres,m_ParticleShadowVisible.data());
+				for (u32 i=0;i<p_Batch.instance_count;i++) m_ParticleVisible[i] |= m_ParticleShadowVisible[i];
+			}
+		}
+
+		// skip upload when instances & their visibility did not change
+		if (!p_Batch.instances_changed&&p_Batch.visibility==m_ParticleVisible) continue;
+		p_Batch.visibility = m_ParticleVisible;
+		p_Batch.instances_changed = false;
+
+		// compact visible instances
+		p_Batch.compacted.resize(p_Batch.instances.size());
+		u32 __Visible = 0;
+		for (u32 i=0;i<p_Batch.instance_count;i++)
+		{
+			if (!m_ParticleVisible[i]) continue;
+			memcpy(&p_Batch.compacted[__Visible*p_Batch.instance_stride],
+				   &p_Batch.instances[i*p_Batch.instance_stride],p_Batch.instance_stride);
+			__Visible++;
+		}
+		p_Batch.ibo.bind();
+		p_Batch.ibo.upload_vertices(p_Batch.compacted.data(),__Visible*p_Batch.instance_stride,GL_DYNAMIC_DRAW);
+		p_Batch.active_particles = __Visible;
+	}
+}
+
+/**
+ *	write a range of changed lights into the lighting block
+ *	\param ubo: bound lighting uniform buffer
+ *	\param lights: current light array
+ *	\param state: light array as last written to the gpu, changed lights are updated
+ *	\param count: amount of active lights
+ *	\param offset: byte offset of the light array within the lighting block
+ */
+template<typename T> void _upload_light_ranges(UniformBuffer& ubo,T* lights,T* state,s32 count,size_t offset)
+{
+	s32 i = 0;
+	while (i<count)
+	{
+		if (!memcmp(&lights[i],&state[i],sizeof(T)))
+		{
+			i++;
+			continue;
+		}
+
+		// gather contiguous changed lights
+		s32 __RangeStart = i;
+		while (i<count&&memcmp(&lights[i],&state[i],sizeof(T))) i++;
+		size_t __RangeSize = (i-__RangeStart)*sizeof(T);
+		memcpy(&state[__RangeStart],&lights[__RangeStart],__RangeSize);
+		ubo.upload(&lights[__RangeStart],offset+__RangeStart*sizeof(T),__RangeSize);
 	}
 }
 
 /**
- *	draw casting geometry simplified for shadow projection
- *	\param gb: casting geometry batches for shadow projection
- *	\param pb: casting particle batches for shadow projection
+ *	write per-frame camera, lighting & shadow state into the shared uniform blocks
  */
-void Renderer::_update_shadows(list<lptr<GeometryBatch>>& gb,list<lptr<ParticleBatch>>& pb)
+void Renderer::_update_uniform_blocks()
 {
-	// iterate static geometry
-	for (lptr<GeometryBatch> p_Batch : gb)
+	// camera
+	CameraUniformBlock __Camera = {
+		.view = g_Camera.view,
+		.proj = g_Camera.proj,
+		.position = g_Camera.position
+	};
+	if (memcmp(&__Camera,&m_CameraBlockState,sizeof(CameraUniformBlock)))
 	{
-		m_GeometryShadowPipeline->enable();  // TODO make this dynamic
-		m_GeometryShadowPipeline->upload_camera(m_Lighting.shadow_projection);
-		p_Batch->vao.bind();
-		for (GeometryTuple& p_Tuple : p_Batch->object)
+		m_CameraBlockState = __Camera;
+		m_LightClustersDirty = true;
+		m_CameraUniformBuffer.bind();
+		m_CameraUniformBuffer.upload(&m_CameraBlockState,0,sizeof(CameraUniformBlock));
+	}
+
+	// shadow cascades
+	ShadowUniformBlock __Shadow = {
+		.source = m_Lighting.shadow_source,
+		.cascades = RENDERER_SHADOW_CASCADES
+	};
+	for (u8 i=0;i<RENDERER_SHADOW_CASCADE_LIMIT;i++)
+		__Shadow.projection[i] = (i<RENDERER_SHADOW_CASCADES)
+				? m_Lighting.shadow_cascades[i].proj*m_Lighting.shadow_cascades[i].view : mat4(.0f);
+	if (memcmp(&__Shadow,&m_ShadowBlockState,sizeof(ShadowUniformBlock)))
+	{
+		m_ShadowBlockState = __Shadow;
+		m_ShadowUniformBuffer.bind();
+		m_ShadowUniformBuffer.upload(&m_ShadowBlockState,0,sizeof(ShadowUniformBlock));
+	}
+
+	// lighting, only when requested through upload_lighting. pointlights are written by the light clustering
+	if (!m_LightingChanged) return;
+	m_LightingUniformBuffer.bind();
+	_upload_light_ranges(m_LightingUniformBuffer,m_Lighting.sunlights,m_LightingBlockState.sunlights,
+						 m_Lighting.sunlights_active,offsetof(LightingUniformBlock,sunlights));
+
+	// light counts
+	if (m_Lighting.sunlights_active!=m_LightingBlockState.sunlights_active)
+	{
+		m_LightingBlockState.sunlights_active = m_Lighting.sunlights_active;
+		m_LightingUniformBuffer.upload(&m_LightingBlockState.sunlights_active,
+									   offsetof(LightingUniformBlock,sunlights_active),sizeof(s32));
+	}
+	m_LightClustersDirty = true;
+	m_LightingChanged = false;
+}
+
+/**
+ *	adjust the internal resolution of the 3D segment to keep the frame within FRAME_TIME_BUDGET_MS
+ *	gpu time is read from the oldest timestamps, which finished while the later frames were recorded.
+ *	only the 3D segment is assumed to scale with its area, the rest of the frame is a fixed cost.
+ *	the segment time is normalized by the scale it was rendered at, so older frames stay comparable
+ *	NOTE cpu time is measured from frame start to the end of submission, excluding the wait for the swap
+ *	NOTE frames where the cpu work alone exceeds the budget are never downscaled, fewer pixels can't help them
+ */
+void Renderer::_update_resolution()
+{
+	if (m_FrameQueriesIssued<RENDERER_FRAME_QUERIES) return;
+
+	// measure gpu frame time without stalling on pending queries, the last timestamp finishes after the others
+	u8 __Slot = m_FrameQueriesIssued%RENDERER_FRAME_QUERIES;
+	s32 __Available;
+	glGetQueryObjectiv(m_FrameQueries[__Slot][3],GL_QUERY_RESULT_AVAILABLE,&__Available);
+	if (!__Available) return;
+	u64 __Timestamps[4];
+	for (u8 i=0;i<4;i++) glGetQueryObjectui64v(m_FrameQueries[__Slot][i],GL_QUERY_RESULT,&__Timestamps[i]);
+	f32 __ScaledTime = (__Timestamps[2]-__Timestamps[1])*.000001f;
+	f32 __FixedTime = (__Timestamps[1]-__Timestamps[0]+__Timestamps[3]-__Timestamps[2])*.000001f;
+	f32 __Scale = m_FrameQueryScales[__Slot];
+	m_GPUAreaTime = glm::mix(m_GPUAreaTime,__ScaledTime/(__Scale*__Scale),RENDERER_RESOLUTION_SMOOTHING);
+	m_GPUFixedTime = glm::mix(m_GPUFixedTime,__FixedTime,RENDERER_RESOLUTION_SMOOTHING);
+
+	// scale towards the budget left by the fixed cost, in discrete steps so it does not flicker around the target
+	f32 __Budget = glm::max(FRAME_TIME_BUDGET_MS*RENDERER_RESOLUTION_HEADROOM-m_GPUFixedTime,.0);
+	f32 __Target = glm::sqrt(__Budget/glm::max(m_GPUAreaTime,.001f));
+	__Target = glm::clamp(glm::round(__Target/RENDERER_RESOLUTION_SCALE_STEP)*RENDERER_RESOLUTION_SCALE_STEP,
+						  RENDERER_RESOLUTION_SCALE_MINIMUM,1.f);
+	if (glm::abs(__Target-m_ResolutionScale)<RENDERER_RESOLUTION_SCALE_STEP*.5f) return;
+	if (__Target<m_ResolutionScale&&m_CPUFrameTime>FRAME_TIME_BUDGET_MS) return;
+	m_ResolutionScale = __Target;
+	m_ResolutionX = FRAME_RESOLUTION_X*m_ResolutionScale;
+	m_ResolutionY = FRAME_RESOLUTION_Y*m_ResolutionScale;
+}
+
+/**
+ *	range at which the influence of a pointlight falls below RENDERER_LIGHT_CUTOFF of its brightest channel
+ *	\param light: pointlight to calculate the range for
+ *	\param far: fallback range for lights without attenuation
+ *	\returns influence radius
+ */
+inline f32 _pointlight_radius(PointLight& light,f32 far)
+{
+	// solve quadratic*d²+linear*d+constant = brightness/cutoff for the positive distance
+	f32 __Target = glm::max(light.colour.r,glm::max(light.colour.g,light.colour.b))/RENDERER_LIGHT_CUTOFF;
+	f32 __Constant = light.constant-__Target;
+	if (__Constant>=.0f) return .0f;
+	if (light.quadratic>.0f)
+		return (-light.linear+glm::sqrt(light.linear*light.linear-4.f*light.quadratic*__Constant))
+				/(2.f*light.quadratic);
+	if (light.linear>.0f) return -__Constant/light.linear;
+	return far;
+}
+
+/**
+ *	convert view space depth into cluster slice, slices are distributed logarithmically between near & far
+ *	\param depth: distance to the camera along the view direction
+ *	\param near: logarithm of the near plane distance
+ *	\param scale: slices per logarithmic depth unit
+ *	\returns slice index
+ */
+inline s32 _cluster_slice(f32 depth,f32 near,f32 scale)
+{
+	return glm::clamp((s32)glm::floor((glm::log(depth)-near)*scale),0,RENDERER_LIGHT_CLUSTERS_Z-1);
+}
+
+/**
+ *	convert normalized device coordinate into cluster tile
+ *	\param ndc: normalized device coordinate
+ *	\param tiles: tiles along the axis
+ *	\returns tile index
+ */
+inline s32 _cluster_tile(f32 ndc,s32 tiles)
+{
+	return glm::clamp((s32)glm::floor((ndc*.5f+.5f)*tiles),0,tiles-1);
+}
+
+/**
+ *	assign pointlights to the view clusters their range intersects & write the cluster buffer
+ *	buffer layout in rgba32ui texels:
+ *	  - one header per cluster, holding the offset of its first light index in components & the index count
+ *	  - light indices, four per texel
+ *	  - pointlights, three texels each, starting at m_LightClusterLightOffset
+ *	NOTE light spheres are bound by their projected screen rectangle & depth range, which is conservative
+ */
+void Renderer::_update_light_clusters()
+{
+	if (!m_LightClustersDirty) return;
+	m_LightClustersDirty = false;
+	u32 __Lights = m_PointLights.size();
+
+	// gather light positions in structure of arrays, so the view transformation vectorizes
+	m_LightViewX.resize(__Lights);
+	m_LightViewY.resize(__Lights);
+	m_LightViewZ.resize(__Lights);
+	m_LightRadius.resize(__Lights);
+	u32 i = 0;
+	for (PointLight& p_Light : m_PointLights)
+	{
+		p_Light.radius = _pointlight_radius(p_Light,g_Camera.far);
+		m_LightViewX[i] = p_Light.position.x;
+		m_LightViewY[i] = p_Light.position.y;
+		m_LightViewZ[i] = p_Light.position.z;
+		m_LightRadius[i++] = p_Light.radius;
+	}
+	mat4& p_View = g_Camera.view;
+	for (i=0;i<__Lights;i++)
+	{
+		f32 __X = m_LightViewX[i],__Y = m_LightViewY[i],__Z = m_LightViewZ[i];
+		m_LightViewX[i] = p_View[0][0]*__X+p_View[1][0]*__Y+p_View[2][0]*__Z+p_View[3][0];
+		m_LightViewY[i] = p_View[0][1]*__X+p_View[1][1]*__Y+p_View[2][1]*__Z+p_View[3][1];
+		m_LightViewZ[i] = -(p_View[0][2]*__X+p_View[1][2]*__Y+p_View[2][2]*__Z+p_View[3][2]);
+	}
+
+	// cluster bounds of all lights, lights outside of the view are marked by an empty depth range
+	f32 __Near = glm::log(g_Camera.near);
+	f32 __Scale = RENDERER_LIGHT_CLUSTERS_Z/glm::log(g_Camera.far/g_Camera.near);
+	mat4& p_Proj = g_Camera.proj;
+	bool __Perspective = p_Proj[2][3]!=.0f;
+	m_LightClusterBounds.resize(__Lights*6);
+	m_LightClusterCounts.assign(RENDERER_LIGHT_CLUSTERS,0);
+	for (i=0;i<__Lights;i++)
+	{
+		u8* __Bounds = &m_LightClusterBounds[i*6];
+		f32 __X = m_LightViewX[i],__Y = m_LightViewY[i],__Depth = m_LightViewZ[i],__R = m_LightRadius[i];
+		__Bounds[4] = 1;
+		__Bounds[5] = 0;
+		if (__Depth+__R<g_Camera.near||__Depth-__R>g_Camera.far) continue;
+
+		// screen rectangle, extremes of x/depth over the bounding box lie on its corners
+		vec2 __Min = vec2(-1.f),__Max = vec2(1.f);
+		if (!__Perspective)
+		{
+			__Min = vec2(p_Proj[0][0]*(__X-__R),p_Proj[1][1]*(__Y-__R))+vec2(p_Proj[3]);
+			__Max = vec2(p_Proj[0][0]*(__X+__R),p_Proj[1][1]*(__Y+__R))+vec2(p_Proj[3]);
+		}
+		else if (__Depth-__R>g_Camera.near)
+		{
+			f32 __Inner = 1.f/(__Depth-__R),__Outer = 1.f/(__Depth+__R);
+			f32 __Left = p_Proj[0][0]*(__X-__R),__Right = p_Proj[0][0]*(__X+__R);
+			f32 __Bottom = p_Proj[1][1]*(__Y-__R),__Top = p_Proj[1][1]*(__Y+__R);
+			__Min = vec2(glm::min(__Left*__Inner,__Left*__Outer),glm::min(__Bottom*__Inner,__Bottom*__Outer));
+			__Max = vec2(glm::max(__Right*__Inner,__Right*__Outer),glm::max(__Top*__Inner,__Top*__Outer));
+		}
+		if (__Max.x<-1.f||__Min.x>1.f||__Max.y<-1.f||__Min.y>1.f) continue;
+
+		// cluster ranges
+		__Bounds[0] = _cluster_tile(__Min.x,RENDERER_LIGHT_CLUSTERS_X);
+		__Bounds[1] = _cluster_tile(__Max.x,RENDERER_LIGHT_CLUSTERS_X);
+		__Bounds[2] = _cluster_tile(__Min.y,RENDERER_LIGHT_CLUSTERS_Y);
+		__Bounds[3] = _cluster_tile(__Max.y,RENDERER_LIGHT_CLUSTERS_Y);
+		__Bounds[4] = _cluster_slice(glm::max(__Depth-__R,g_Camera.near),__Near,__Scale);
+		__Bounds[5] = _cluster_slice(glm::min(__Depth+__R,g_Camera.far),__Near,__Scale);
+
+		// count light references per cluster
+		for (u32 z=__Bounds[4];z<=__Bounds[5];z++)
+		{
+			for (u32 y=__Bounds[2];y<=__Bounds[3];y++)
+			{
+				u32* __Row = &m_LightClusterCounts[(z*RENDERER_LIGHT_CLUSTERS_Y+y)*RENDERER_LIGHT_CLUSTERS_X];
+				for (u32 x=__Bounds[0];x<=__Bounds[1];x++) __Row[x]++;
+			}
+		}
+	}
+
+	// write cluster headers, turning counts into write cursors
+	u32 __Cursor = RENDERER_LIGHT_CLUSTERS*4;
+	m_LightClusterData.assign(RENDERER_LIGHT_CLUSTERS*4,0);
+	for (u32 c=0;c<RENDERER_LIGHT_CLUSTERS;c++)
+	{
+		m_LightClusterData[c*4] = __Cursor;
+		m_LightClusterData[c*4+1] = m_LightClusterCounts[c];
+		m_LightClusterCounts[c] = __Cursor;
+		__Cursor += m_LightClusterData[c*4+1];
+	}
+
+	// scatter light indices
+	m_LightClusterLightOffset = (__Cursor+3)/4;
+	m_LightClusterData.resize(m_LightClusterLightOffset*4+__Lights*12);
+	for (i=0;i<__Lights;i++)
+	{
+		u8* __Bounds = &m_LightClusterBounds[i*6];
+		for (u32 z=__Bounds[4];z<=__Bounds[5];z++)
 		{
-			// TODO geometry uniform upload, this will only be applicable if dynamic shading pipeline is working
-			m_GeometryShadowPipeline->upload("model",p_Tuple.transform.model);
-			glDrawArrays(GL_TRIANGLES,p_Tuple.offset,p_Tuple.vertex_count);
+			for (u32 y=__Bounds[2];y<=__Bounds[3];y++)
+			{
+				u32* __Row = &m_LightClusterCounts[(z*RENDERER_LIGHT_CLUSTERS_Y+y)*RENDERER_LIGHT_CLUSTERS_X];
+				for (u32 x=__Bounds[0];x<=__Bounds[1];x++) m_LightClusterData[__Row[x]++] = i;
+			}
 		}
 	}
 
-	// iterate particle geometry
-	for (lptr<ParticleBatch> p_Batch : pb)
+	// append light data & upload
+	i = m_LightClusterLightOffset*4;
+	for (PointLight& p_Light : m_PointLights)
 	{
-		m_ParticleShadowPipeline->enable();  // TODO same here as with m_GeometryShadowPipeline
-		m_ParticleShadowPipeline->upload_camera(m_Lighting.shadow_projection);
-		p_Batch->vao.bind();
-		glDrawArraysInstanced(GL_TRIANGLES,0,p_Batch->vertex_count,p_Batch->active_particles);
+		memcpy(&m_LightClusterData[i],&p_Light,sizeof(PointLight));
+		i += 12;
 	}
+	m_LightClusterBuffer.upload(&m_LightClusterData[0],m_LightClusterData.size()*sizeof(u32),GL_RGBA32UI);
 }
 
 /**
@@ -1034,25 +3092,145 @@ void Renderer::_update_shadows(list<lptr<GeometryBatch>>& gb,list<lptr<ParticleB
  */
 void Renderer::_gpu_upload()
 {
-	m_GPUSpriteTextures.gpu_upload(RENDERER_TEXTURE_SPRITES,m_FrameStart);
-	m_GPUFontTextures.gpu_upload(RENDERER_TEXTURE_FONTS,m_FrameStart);
+	m_GPUSpriteTextures.gpu_upload(RENDERER_TEXTURE_SPRITES,m_PixelUploadRing,m_FrameStart);
+	m_GPUFontTextures.gpu_upload(RENDERER_TEXTURE_FONTS,m_PixelUploadRing,m_FrameStart);
+
+	// sprites follow their textures through atlas defragmentation, coordinates are read from the patched components
+	if (m_GPUSpriteTextures.relocated)
+	{
+		for (u16 i=0;i<m_Sprites.active_range;i++)
+		{
+			Sprite& p_Sprite = m_Sprites.mem[i];
+			if (!p_Sprite.texture||p_Sprite.tex_position==p_Sprite.texture->offset) continue;
+			p_Sprite.tex_position = p_Sprite.texture->offset;
+			update_sprite(&p_Sprite);
+		}
+		m_GPUSpriteTextures.relocated = false;
+	}
 
-	// singular textures
+	// singular textures, uploads are staged through the ring & stop when it is busy or the frame budget is spent
 	m_MutexMeshTextureUpload.lock();
-	while (m_MeshTextureUploadQueue.size()/*&&calculate_delta_time(m_FrameStart)<FRAME_TIME_BUDGET_MS*/)
+	while (m_MeshTextureUploadQueue.size()&&calculate_delta_time(m_FrameStart)<FRAME_TIME_BUDGET_MS)
 	{
 		TextureDataTuple& p_Tuple = m_MeshTextureUploadQueue.front();
+		TextureData& p_Data = p_Tuple.data;
 		p_Tuple.texture->bind(RENDERER_TEXTURE_UNMAPPED);
-		p_Tuple.data.gpu_upload();
-		m_MeshTextureUploadQueue.pop();
+		if (!p_Data.compressed())
+		{
+			if (!p_Data.gpu_upload(m_PixelUploadRing)) break;
+			Texture::generate_mipmap();
+		}
+		else
+		{
+			// compressed textures become resident with their coarse levels, finer levels are streamed by demand
+			u8 __Coarsest = p_Data.levels.size()-1;
+			u8 __Resident = __Coarsest;
+			while (__Resident&&glm::max(p_Data.levels[__Resident-1].width,p_Data.levels[__Resident-1].height)
+				   <=RENDERER_TEXTURE_STREAM_RESIDENT) __Resident--;
+			if (!p_Data.gpu_upload_levels(m_PixelUploadRing,__Resident,__Coarsest)) break;
+			Texture::set_texture_parameter_level_range(__Resident,__Coarsest);
+			if (__Resident) m_MeshTextureStreams.push_back({ p_Data,p_Tuple.texture,__Resident });
+		}
 		Texture::set_texture_parameter_linear_mipmap();
 		Texture::set_texture_parameter_repeat();
-		Texture::generate_mipmap();
+		m_MeshTextureUploadQueue.pop();
 	}
 	m_MutexMeshTextureUpload.unlock();
+	_stream_textures();
 }
 // FIXME the same is happening in buffer.cpp, it seems untidy and is worth another thought
 
+/**
+ *	evict least recently used glyphs when the font atlas runs full & submit requested glyphs for rasterization
+ *	NOTE only glyphs not referenced by any text are evicted, evicted glyphs are rasterized again when requested
+ *	NOTE only fonts with glyphs that did not fit into the atlas are relayouted after an eviction
+ */
+void Renderer::_update_glyphs()
+{
+	// evict down to the target occupancy, so eviction does not run again with every new glyph
+	if (m_GPUFontTextures.occupancy()>RENDERER_GLYPH_CACHE_OCCUPANCY)
+	{
+		vector<std::pair<Font*,Glyph*>> __Unused;
+		for (Font& p_Font : m_Fonts)
+		{
+			for (std::pair<const u32,Glyph>& p_Pair : p_Font.glyphs)
+			{
+				if (!p_Pair.second.references&&p_Pair.second.ready()) __Unused.push_back({ &p_Font,&p_Pair.second });
+			}
+		}
+		std::sort(__Unused.begin(),__Unused.end(),[](std::pair<Font*,Glyph*>& a,std::pair<Font*,Glyph*>& b)
+				  { return a.second->last_use<b.second->last_use; });
+		u32 __Evicted = 0;
+		while (__Evicted<__Unused.size()&&m_GPUFontTextures.occupancy()>RENDERER_GLYPH_CACHE_TARGET)
+		{
+			std::pair<Font*,Glyph*>& p_Unused = __Unused[__Evicted++];
+			m_GPUFontTextures.release(&p_Unused.second->comp);
+			p_Unused.first->glyphs.erase(p_Unused.second->codepoint);
+		}
+		COMM_LOG("evicted %u glyphs from font atlas",__Evicted);
+
+		// glyphs, which did not fit before, are requested again by the relayout of their font
+		if (__Evicted)
+		{
+			for (Font& p_Font : m_Fonts)
+			{
+				if (p_Font.overflow.exchange(false)) p_Font.revision++;
+			}
+		}
+	}
+
+	// rasterize requested glyphs per font in one task, the face can only be used by one worker at a time
+	u32 __GlyphMemory = (BUFFER_FONT_SDF_SIZE+2*BUFFER_FONT_SDF_SPREAD)*(BUFFER_FONT_SDF_SIZE+2*BUFFER_FONT_SDF_SPREAD);
+	for (Font& p_Font : m_Fonts)
+	{
+		if (!p_Font.pending.size()) continue;
+		g_Loader.submit(std::bind(GPUPixelBuffer::load_glyphs,&m_GPUFontTextures,&p_Font,p_Font.pending),nullptr,
+						&p_Font,p_Font.pending.size()*__GlyphMemory,LOADER_PRIORITY_INTERFACE);
+		p_Font.pending.clear();
+	}
+}
+
+/**
+ *	upload finer mip levels of streamed textures, which are requested by visible geometry
+ *	NOTE textures with the highest demand relative to their resident resolution are served first
+ *	NOTE at least one level is uploaded per frame, even if it alone exceeds RENDERER_TEXTURE_STREAM_BUDGET
+ */
+void Renderer::_stream_textures()
+{
+	// finest required level of each texture, the coarsest level still covering its demand
+	vector<std::pair<f32,u32>> __Requests;
+	for (u32 i=0;i<m_MeshTextureStreams.size();i++)
+	{
+		TextureStream& p_Stream = m_MeshTextureStreams[i];
+		TextureLevel& p_Level = p_Stream.data.levels[p_Stream.resident];
+		f32 __Deficit = p_Stream.texture->demand/glm::max(p_Level.width,p_Level.height);
+		p_Stream.texture->demand = .0f;
+		if (__Deficit>1.f) __Requests.push_back({ __Deficit,i });
+	}
+	std::sort(__Requests.begin(),__Requests.end(),
+			  [](const std::pair<f32,u32>& a,const std::pair<f32,u32>& b) { return a.first>b.first; });
+
+	// upload one finer level per requesting texture, within the budget
+	size_t __Uploaded = 0;
+	for (std::pair<f32,u32>& p_Request : __Requests)
+	{
+		TextureStream& p_Stream = m_MeshTextureStreams[p_Request.second];
+		u8 __Level = p_Stream.resident-1;
+		u32 __Size = p_Stream.data.levels[__Level].size;
+		if (__Uploaded&&__Uploaded+__Size>RENDERER_TEXTURE_STREAM_BUDGET) break;
+		p_Stream.texture->bind(RENDERER_TEXTURE_UNMAPPED);
+		if (!p_Stream.data.gpu_upload_levels(m_PixelUploadRing,__Level,__Level)) break;
+		Texture::set_texture_parameter_level_range(__Level,p_Stream.data.levels.size()-1);
+		p_Stream.resident = __Level;
+		__Uploaded += __Size;
+	}
+
+	// fully resident textures stop streaming
+	m_MeshTextureStreams.erase(std::remove_if(m_MeshTextureStreams.begin(),m_MeshTextureStreams.end(),
+											  [](TextureStream& p_Stream) { return !p_Stream.resident; }),
+							   m_MeshTextureStreams.end());
+}
+
 
 // ----------------------------------------------------------------------------------------------------
 // Background Processes
@@ -4,6 +4,7 @@
 
 #include "buffer.h"
 #include "shader.h"
+#include "loader.h"
 
 
 constexpr f32 RENDERER_POSITIONAL_DELETION_CODE = -1247.f;
@@ -14,13 +15,13 @@ enum TextureChannelMap : u16
 	RENDERER_TEXTURE_FONTS,
 	RENDERER_TEXTURE_FORWARD,
 	RENDERER_TEXTURE_DEFERRED_COLOUR,
-	RENDERER_TEXTURE_DEFERRED_POSITION,
 	RENDERER_TEXTURE_DEFERRED_NORMAL,
 	RENDERER_TEXTURE_DEFERRED_MATERIAL,
 	RENDERER_TEXTURE_DEFERRED_EMISSION,
 	RENDERER_TEXTURE_SHADOW_MAP,
 	RENDERER_TEXTURE_FORWARD_DEPTH,
 	RENDERER_TEXTURE_DEFERRED_DEPTH,
+	RENDERER_TEXTURE_LIGHT_CLUSTERS,
 	RENDERER_TEXTURE_UNMAPPED
 };
 
@@ -60,8 +61,19 @@ struct Sprite
 	f32 alpha = 1.f;
 	vec2 tex_position;
 	vec2 tex_dimension;
+	PixelBufferComponent* texture = nullptr;  // atlas coordinates are read again when the atlas is repacked
 };
 
+struct SpriteInstance
+{
+	vec3 offset;
+	vec2 scale;
+	u32 rotation_alpha;
+	u32 tex_position;
+	u32 tex_dimension;
+};
+// rotation & alpha are packed as half floats, atlas coordinates as normalized 16-bit integers
+
 struct TextCharacter
 {
 	vec3 offset = vec3(0);
@@ -79,6 +91,16 @@ struct Vertex
 	vec3 tangent;
 };
 
+struct CompressedVertex
+{
+	u32 position_xy;
+	u32 position_z;
+	u32 uv;
+	u32 normal;
+	u32 tangent;
+};
+// position is packed as half floats, uv as normalized 16-bit integers, normal & tangent as snorm 10:10:10:2
+
 
 // ----------------------------------------------------------------------------------------------------
 // Entity Data
@@ -86,8 +108,11 @@ struct Vertex
 struct Text
 {
 	// utility
+	void print(const char* format,...) __attribute__((format(printf,2,3)));
+	bool update();
 	void align();
 	void load_buffer();
+	void release();
 	u32 intersection(f32 pos);
 
 	// data
@@ -100,6 +125,89 @@ struct Text
 	Alignment alignment;
 	string data;
 	vector<TextCharacter> buffer;
+	vector<Glyph*> glyphs;  // referenced by the buffer, protected from glyph cache eviction
+	u32 revision = 0;  // font revision the buffer has been loaded with
+	u64 hash = 0;  // content & layout parameters of the last layout
+	bool dirty = true;  // buffer changed since the last upload
+};
+
+// vertex cache optimization scoring, after forsyth's linear-speed triangle reordering
+constexpr f32 RENDERER_VERTEX_CACHE_DECAY_POWER = 1.5f;
+constexpr f32 RENDERER_VERTEX_CACHE_LAST_TRIANGLE_SCORE = .75f;
+constexpr f32 RENDERER_VERTEX_CACHE_VALENCE_SCALE = 2.f;
+constexpr f32 RENDERER_VERTEX_CACHE_VALENCE_POWER = .5f;
+
+// simplification stops when a pass removes less than this fraction of triangles
+constexpr f32 RENDERER_MESH_LOD_MIN_REDUCTION = .1f;
+
+// symmetric error quadric, sums squared distances to a set of weighted planes
+struct Quadric
+{
+	// utility
+	void add_plane(vec3 normal,f32 distance,f32 weight);
+	void add(Quadric& quadric);
+	f32 evaluate(vec3 position);
+
+	// data
+	f32 q[10] = { .0f };  // upper triangle of the 4x4 matrix, row by row
+	f32 weight = .0f;
+};
+
+// candidate half-edge collapse, merging the source vertex into the target vertex
+struct EdgeCollapse
+{
+	u32 source;
+	u32 target;
+	f32 error;  // mean squared distance of the merged position to the planes of both vertices
+};
+
+// index range of a mesh level of detail, all levels share the vertices of the mesh
+struct LevelOfDetail
+{
+	u32 index_offset;
+	u32 index_count;
+	f32 error;  // largest geometric deviation from the full resolution mesh, in object space
+};
+
+// .obj sources are parsed in parallel chunks of at least this size, split at line boundaries
+constexpr size_t RENDERER_OBJ_CHUNK_SIZE = 0x10000;
+
+// section of an .obj source, with element counts & offsets to place its elements in the mesh lists
+struct ObjChunk
+{
+	const char* begin;
+	const char* end;
+	u32 positions = 0;
+	u32 uvs = 0;
+	u32 normals = 0;
+	u32 triangles = 0;
+	u32 position_offset = 0;
+	u32 uv_offset = 0;
+	u32 normal_offset = 0;
+	u32 triangle_offset = 0;
+};
+
+// triangulated face corner, absolute attribute indices or -1 for attributes missing in the source
+struct ObjCorner
+{
+	s32 position;
+	s32 uv;
+	s32 normal;
+};
+
+// binary cache of processed mesh geometry, followed by vertices, indices & levels of detail
+constexpr u32 RENDERER_MESH_CACHE_MAGIC = 0x4853454d;  // "MESH"
+constexpr u32 RENDERER_MESH_CACHE_VERSION = 1;  // increase when vertex layout or mesh processing changes
+struct MeshCacheHeader
+{
+	u32 magic;
+	u32 version;
+	u64 source_hash;  // invalidates the cache when the source file changes
+	u32 vertex_count;
+	u32 index_count;
+	u32 lod_count;
+	u32 lod_limit;  // invalidates the cache when the configured amount of levels changes
+	BoundingVolume bounds;
 };
 
 class Mesh
@@ -110,9 +218,91 @@ public:
 	static inline Mesh sphere_high_resolution() { return Mesh("./res/sphere.obj"); };
 	static inline Mesh cube() { return Mesh("./res/cube.obj"); }
 	static inline Mesh triangle() { return Mesh("./res/triangle.obj"); }
+	void append(Mesh& mesh);
+	void compress(vector<CompressedVertex>& data);
+
+private:
+	void _load_obj(MappedFile& source);
+	static void _count_obj_chunk(ObjChunk& chunk);
+	static void _parse_obj_chunk(ObjChunk& chunk,vec3* positions,vec2* uvs,vec3* normals,ObjCorner* corners);
+	static void _write_triangles(Vertex* triangles,ObjCorner* corners,u32 count,vector<vec3>& positions,
+								 vector<vec2>& uvs,vector<vec3>& normals);
+	bool _read_cache(const char* path,u64 source);
+	void _write_cache(const char* path,u64 source);
+	void _weld();
+	void _generate_lods();
+	bool _simplify(vector<u32>& triangles,u32 target,f32& error);
+	void _optimize_triangle_order(vector<u32>& triangles);
+	void _optimize_vertex_order();
+	static f32 _vertex_cache_score(s32 position,u32 valence);
 
 public:
 	vector<Vertex> vertices;
+	vector<u32> indices;
+	vector<LevelOfDetail> lods;
+	BoundingVolume bounds;
+};
+
+
+// ----------------------------------------------------------------------------------------------------
+// Geometry Pool
+
+struct GeometryPoolRange
+{
+	size_t offset;
+	size_t count;
+};
+
+// buffer memory, sub-allocated in elements of a fixed width
+struct GeometryPoolMemory
+{
+	size_t allocate(void* data,size_t count,size_t stride);
+	void release(size_t offset,size_t count);
+	void upload(GLenum target);
+
+	vector<u8> data;  // ram copy of buffer memory, to grow the buffer & verify mesh matches
+	vector<GeometryPoolRange> free_ranges;
+	size_t capacity = 0;
+	size_t dirty_begin = 0;
+	size_t dirty_end = 0;
+};
+
+struct GeometryPoolMesh
+{
+	size_t offset;
+	size_t vertex_count;
+	size_t index_offset;
+	size_t index_count;
+	u32 references;
+};
+
+// geometry memory shared by all pipelines with the same vertex layout
+struct GeometryLayout
+{
+	VertexArray vao;
+	VertexBuffer vbo;
+	VertexBuffer ebo;
+	VertexBuffer ibo;  // instance stream of instanced geometry batches
+	size_t stride;
+	bool compressed;  // pipelines expect meshes as compressed vertices
+	GeometryPoolMemory vertices;
+	GeometryPoolMemory indices;
+	map<u64,GeometryPoolMesh> meshes;
+};
+
+// mesh reference returned by failed allocations, never produced by a stored mesh
+constexpr u64 RENDERER_INVALID_MESH = 0;
+
+class GeometryPool
+{
+public:
+	GeometryLayout* get_layout(ShaderPipeline* shader,bool instanced);
+	u64 allocate(GeometryLayout* layout,void* verts,size_t size,u32* indices,size_t isize);
+	void release(GeometryLayout* layout,u64 mesh);
+	void upload();
+
+private:
+	map<u64,GeometryLayout> m_Layouts;
 };
 
 
@@ -125,9 +315,17 @@ struct TextureDataTuple
 	Texture* texture;
 };
 
+// compressed texture, which mip levels are progressively uploaded by demand
+struct TextureStream
+{
+	TextureData data;
+	Texture* texture;
+	u8 resident;  // finest uploaded level
+};
+
 struct GeometryUniformUpload
 {
-	u32 uloc;
+	s32 uloc;
 	UniformDimension udim;
 	f32* data;
 };
@@ -136,10 +334,22 @@ struct GeometryTuple
 {
 	size_t offset;
 	size_t vertex_count;
+	vector<LevelOfDetail> lods;  // index ranges within pooled index memory
+	u8 lod = 0;  // level selected by the last colour pass
 	Transform3D transform;
 	vector<Texture*> textures;
 	vector<GeometryUniformUpload> uploads;
 	f32 texel = 1.f;
+	BoundingVolume bounds;
+	bool static_caster = false;  // never moving shadow caster, cached in the static shadow map
+	u64 mesh = RENDERER_INVALID_MESH;  // mesh reference within the geometry pool
+};
+
+// per-instance layout of geometry batches drawn by instancing, see gpass.vert
+struct GeometryInstance
+{
+	mat4 model;
+	f32 texel;
 };
 
 struct GeometryBatch
@@ -148,7 +358,9 @@ struct GeometryBatch
 	// batch geometry loading
 	u32 add_geometry(Mesh& mesh,vector<Texture*>& tex);
 	u32 add_geometry(void* verts,size_t vsize,size_t ssize,vector<Texture*>& tex);
+	u32 add_geometry(void* verts,size_t vsize,size_t ssize,u32* indices,size_t isize,vector<Texture*>& tex);
 	void load();
+	void clear();
 
 	// auto uniform upload
 	void attach_uniform(u32 gid,const char* name,f32* var);
@@ -158,13 +370,14 @@ struct GeometryBatch
 	void attach_uniform(u32 gid,const char* name,mat4* var);
 
 	// data
-	VertexArray vao;
-	VertexBuffer vbo;
 	lptr<ShaderPipeline> shader;
+	GeometryPool* pool;
+	GeometryLayout* layout = nullptr;
 	vector<GeometryTuple> object;
-	vector<float> geometry;
-	u32 geometry_cursor = 0;
-	u32 offset_cursor = 0;
+	bool instanced = false;  // repeated geometry is drawn instanced, if the pipeline supports it
+
+private:
+	void _resolve_layout();
 };
 
 struct ParticleBatch
@@ -172,43 +385,190 @@ struct ParticleBatch
 	// utility
 	void load(Mesh& mesh,u32 particles);
 	void load(void* verts,size_t vsize,size_t ssize,u32 particles);
+	void load(void* verts,size_t vsize,size_t ssize,u32* indices,size_t isize,u32 particles);
+	void clear();
+
+	/**
+	 *	hand instances to the renderer instead of uploading them to the ibo directly, this way only
+	 *	instances intersecting the view or shadow frustum are uploaded and drawn
+	 *	\param data: instance memory
+	 *	\param count: amount of instances
+	 *	NOTE instance structs have to begin with vec3 offset, followed by f32 scale
+	 */
+	template<typename T> inline void upload_instances(T* data,u32 count)
+	{
+		instances.resize(count*sizeof(T));
+		memcpy(instances.data(),data,count*sizeof(T));
+		instance_count = count;
+		instance_stride = sizeof(T);
+		instances_changed = true;
+	}
 
 	// data
 	VertexArray vao;
-	VertexBuffer vbo;
 	VertexBuffer ibo;
 	lptr<ShaderPipeline> shader;
-	vector<float> geometry;
-	u32 vertex_count;
+	GeometryPool* pool;
+	GeometryLayout* layout = nullptr;
+	u64 mesh = RENDERER_INVALID_MESH;
+	u32 vertex_offset = 0;
+	vector<LevelOfDetail> lods;
+	u8 lod = 0;  // level of the most prominent visible instance
+	f32 distance = .0f;  // distance of the closest visible instance, orders blended batches
 	u32 active_particles = 0;
+	BoundingVolume bounds;
+	bool shadow_caster = false;
+
+	// culled instances
+	vector<u8> instances;
+	vector<u8> compacted;
+	vector<u8> visibility;
+	u32 instance_count = 0;
+	size_t instance_stride = 0;
+	bool instances_changed = false;
+};
+
+
+// ----------------------------------------------------------------------------------------------------
+// Render Queue
+
+// sort key layout from most to least significant: pipeline | vertex array | texture set | mesh | depth
+// blended queues lead with inverted depth instead: depth | pipeline | vertex array | texture set | mesh
+constexpr u8 RENDERER_QUEUE_PIPELINE_SHIFT = 52;
+constexpr u8 RENDERER_QUEUE_VERTEX_ARRAY_SHIFT = 40;
+constexpr u8 RENDERER_QUEUE_TEXTURE_SHIFT = 24;
+constexpr u8 RENDERER_QUEUE_MESH_SHIFT = 16;
+constexpr u64 RENDERER_QUEUE_ID_MASK = 0xfff;
+constexpr u64 RENDERER_QUEUE_TEXTURE_MASK = 0xffff;
+constexpr u64 RENDERER_QUEUE_MESH_MASK = 0xff;
+constexpr u64 RENDERER_QUEUE_DEPTH_MASK = 0xffff;
+constexpr u8 RENDERER_QUEUE_BLENDED_DEPTH_SHIFT = 48;
+constexpr u8 RENDERER_QUEUE_BLENDED_STATE_SHIFT = 16;
+constexpr u8 RENDERER_QUEUE_TEXTURE_SLOTS = 8;
+
+// opaque geometry is grouped by state, blended geometry has to be composited from back to front
+enum RenderQueueOrder : u8
+{
+	RENDERER_QUEUE_ORDER_STATE,
+	RENDERER_QUEUE_ORDER_BACK_TO_FRONT
+};
+
+enum RenderQueueFilter : u8
+{
+	RENDERER_QUEUE_ALL,
+	RENDERER_QUEUE_STATIC,
+	RENDERER_QUEUE_DYNAMIC
+};
+
+struct RenderCommand
+{
+	u64 key;
+	ShaderPipeline* shader;
+	VertexArray* vao;
+	GeometryTuple* tuple;  // nullptr for particle batches
+	VertexBuffer* ibo;  // instance buffer of instanced geometry batches, nullptr otherwise
+	u32 base_vertex;
+	u32 index_offset;
+	u32 index_count;
+	u32 instances;
+};
+
+class RenderQueue
+{
+public:
+	RenderQueue(RenderQueueOrder order=RENDERER_QUEUE_ORDER_STATE);
+	void begin(Camera3D& camera,bool materials=true);
+	void add(GeometryBatch& batch,ShaderPipeline* shader,RenderQueueFilter filter=RENDERER_QUEUE_ALL);
+	void add(ParticleBatch& batch,ShaderPipeline* shader);
+	void sort();
+	void draw();
+	static u8 select_lod(vector<LevelOfDetail>& lods,u8 current,f32 pixels);
+	static f32 projection_scale(Camera3D& camera);
+
+private:
+	u64 _key(ShaderPipeline* shader,VertexArray* vao,u64 textures,u64 mesh,f32 depth);
+	bool _instanceable(RenderCommand& a,RenderCommand& b);
+
+private:
+	vector<RenderCommand> m_Commands;
+	vector<RenderCommand> m_SortBuffer;
+	vector<GeometryInstance> m_Instances;
+	RenderQueueOrder m_Order;
+	bool m_Materials;
+
+	// culling
+	Frustum m_Frustum;
+	vec3 m_CameraPosition;
+	f32 m_CameraFar;
+	f32 m_ProjectionScale;
+	BoundingSpheres m_Spheres;
+	vector<u8> m_Visible;
 };
 
 
 // ----------------------------------------------------------------------------------------------------
 // Lighting
 
+// sun lights are padded to match their std140 representation within LightingBlock
 struct SunLight
 {
 	vec3 position;
+	f32 __padding0;
 	vec3 colour;
+	f32 __padding1;
 };
 
+// point lights are stored as three texels in the light cluster buffer
 struct PointLight
 {
 	vec3 position;
+	f32 radius;  // influence falls below RENDERER_LIGHT_CUTOFF beyond, written by the light clustering
 	vec3 colour;
 	f32 constant;
 	f32 linear;
 	f32 quadratic;
+	f32 __padding[2];
 };
 
-struct Lighting
+static_assert(sizeof(PointLight)==12*sizeof(u32),"pointlight has to match its cluster buffer texels");
+
+constexpr u32 RENDERER_LIGHT_CLUSTERS = RENDERER_LIGHT_CLUSTERS_X*RENDERER_LIGHT_CLUSTERS_Y*RENDERER_LIGHT_CLUSTERS_Z;
+
+// shadow cascades are limited by the projection array within ShadowBlock
+constexpr u8 RENDERER_SHADOW_CASCADE_LIMIT = 8;
+static_assert(RENDERER_SHADOW_CASCADES>0&&RENDERER_SHADOW_CASCADES<=RENDERER_SHADOW_CASCADE_LIMIT,
+			  "shadow cascade count exceeds ShadowBlock limit");
+
+// std140 representation of LightingBlock, point lights are clustered separately
+struct LightingUniformBlock
 {
 	SunLight sunlights[8];
-	PointLight pointlights[64];
-	u8 sunlights_active = 0;
-	u8 pointlights_active = 0;
-	Camera3D shadow_projection;
+	s32 sunlights_active = 0;
+	s32 __padding[3];
+};
+
+// lighting setup, the uniform block part is uploaded directly
+struct Lighting : LightingUniformBlock
+{
+	vec3 shadow_source = COORDINATE_SYSTEM_ORIENTATION;
+	Camera3D shadow_cascades[RENDERER_SHADOW_CASCADES];
+};
+
+// std140 representation of CameraBlock
+struct CameraUniformBlock
+{
+	mat4 view;
+	mat4 proj;
+	vec3 position;
+	f32 __padding;
+};
+
+// std140 representation of ShadowBlock
+struct ShadowUniformBlock
+{
+	mat4 projection[RENDERER_SHADOW_CASCADE_LIMIT];
+	vec3 source;
+	s32 cascades;
 };
 
 
@@ -224,20 +584,23 @@ public:
 	void exit();
 
 	// sprite
-	PixelBufferComponent* register_sprite_texture(const char* path);
+	PixelBufferComponent* register_sprite_texture(const char* path,LoaderPriority priority=LOADER_PRIORITY_INTERFACE,
+												  LoaderHandle* load=nullptr);
 	Sprite* register_sprite(PixelBufferComponent* texture,vec3 position,vec2 size,f32 rotation=.0f,
 							f32 alpha=1.f,Alignment alignment={});
 	void assign_sprite_texture(Sprite* sprite,PixelBufferComponent* texture);
+	inline void update_sprite(Sprite* sprite) { m_SpriteDirty.set(sprite-m_Sprites.mem); }
 	void delete_sprite_texture(PixelBufferComponent* texture);
-	static void delete_sprite(Sprite* sprite);
+	void delete_sprite(Sprite* sprite);
 
 	// text
-	Font* register_font(const char* path,u16 size);
+	Font* register_font(const char* path,LoaderPriority priority=LOADER_PRIORITY_INTERFACE,LoaderHandle* load=nullptr);
 	lptr<Text> write_text(Font* font,string data,vec3 position,f32 scale,vec4 colour=vec4(1),Alignment align={});
-	inline void delete_text(lptr<Text> text) { m_Texts.erase(text); }
+	inline void delete_text(lptr<Text> text) { text->release(); m_Texts.erase(text); m_TextDirty = true; }
 
 	// textures
-	Texture* register_texture(const char* path,TextureFormat format=TEXTURE_FORMAT_RGBA);
+	Texture* register_texture(const char* path,TextureFormat format=TEXTURE_FORMAT_RGBA,
+							  LoaderPriority priority=LOADER_PRIORITY_VISIBLE,LoaderHandle* load=nullptr);
 
 	// scene
 	lptr<ShaderPipeline> register_pipeline(VertexShader& vs,FragmentShader& fs);
@@ -247,6 +610,10 @@ public:
 	lptr<ParticleBatch> register_particle_batch(lptr<ShaderPipeline> pipeline);
 	lptr<ParticleBatch> register_deferred_particle_batch();
 	lptr<ParticleBatch> register_deferred_particle_batch(lptr<ShaderPipeline> pipeline);
+	void delete_geometry_batch(lptr<GeometryBatch> batch);
+	void delete_deferred_geometry_batch(lptr<GeometryBatch> batch);
+	void delete_particle_batch(lptr<ParticleBatch> batch);
+	void delete_deferred_particle_batch(lptr<ParticleBatch> batch);
 
 	// shadow projection
 	void register_shadow_batch(lptr<GeometryBatch> b);
@@ -268,9 +635,18 @@ private:
 	void _update_sprites();
 	void _update_text();
 	void _update_canvas();
-	static void _update_mesh(list<GeometryBatch>& gb,list<ParticleBatch>& pb);
+	static void _update_mesh(list<GeometryBatch>& gb,list<ParticleBatch>& pb,RenderQueue& queue);
 	void _update_shadows(list<lptr<GeometryBatch>>& gb,list<lptr<ParticleBatch>>& pb);
+	void _update_shadow_cascade(u8 cascade,list<lptr<GeometryBatch>>& gb,list<lptr<ParticleBatch>>& pb,
+								RenderQueueFilter filter);
+	void _update_uniform_blocks();
+	void _update_light_clusters();
+	void _update_resolution();
+	void _update_shadow_cascades();
+	void _cull_particles(list<ParticleBatch>& pb,Frustum& view,Frustum* shadow);
 	void _gpu_upload();
+	void _stream_textures();
+	void _update_glyphs();
 
 	// background procedures
 	template<typename T> static void _collector(InPlaceArray<T>* xs,ThreadSignal* signal);
@@ -284,6 +660,17 @@ private:
 #endif
 	std::chrono::steady_clock::time_point m_FrameStart;
 
+	// dynamic resolution, 3D targets are drawn into a scaled region & upscaled by the canvas pass
+	u32 m_FrameQueries[RENDERER_FRAME_QUERIES][4];  // timestamps: frame start, 3D segment start & end, frame end
+	f32 m_FrameQueryScales[RENDERER_FRAME_QUERIES];
+	u32 m_FrameQueriesIssued = 0;
+	f32 m_CPUFrameTime = .0f;
+	f32 m_GPUAreaTime = .0f;  // 3D segment time at full resolution
+	f32 m_GPUFixedTime = .0f;
+	f32 m_ResolutionScale = 1.f;
+	u32 m_ResolutionX = FRAME_RESOLUTION_X;
+	u32 m_ResolutionY = FRAME_RESOLUTION_Y;
+
 	// ----------------------------------------------------------------------------------------------------
 	// Threading
 
@@ -308,8 +695,13 @@ private:
 	ShaderPipeline m_CanvasPipeline;
 
 	Framebuffer m_ForwardFrameBuffer = Framebuffer(1);
-	Framebuffer m_DeferredFrameBuffer = Framebuffer(5);
+	Framebuffer m_DeferredFrameBuffer = Framebuffer(4);
 	Framebuffer m_ShadowFrameBuffer = Framebuffer(0);
+	Framebuffer m_StaticShadowFrameBuffer = Framebuffer(0);
+
+	UniformBuffer m_CameraUniformBuffer;
+	UniformBuffer m_LightingUniformBuffer;
+	UniformBuffer m_ShadowUniformBuffer;
 
 	// ----------------------------------------------------------------------------------------------------
 	// Render Object Information
@@ -322,13 +714,19 @@ private:
 	InPlaceArray<Texture> m_MeshTextures = InPlaceArray<Texture>(RENDERER_MAXIMUM_TEXTURE_COUNT);
 	queue<TextureDataTuple> m_MeshTextureUploadQueue;
 	std::mutex m_MutexMeshTextureUpload;
+	vector<TextureStream> m_MeshTextureStreams;
+	PixelUploadRing m_PixelUploadRing;
 
 	// sprites
 	InPlaceArray<Sprite> m_Sprites = InPlaceArray<Sprite>(BUFFER_MAXIMUM_TEXTURE_COUNT);
+	SpriteInstance m_SpriteInstances[BUFFER_MAXIMUM_TEXTURE_COUNT];
+	BitwiseWords m_SpriteDirty = BitwiseWords(BUFFER_MAXIMUM_TEXTURE_COUNT);
 
 	// text
-	InPlaceArray<Font> m_Fonts = InPlaceArray<Font>(RENDERER_MAXIMUM_FONT_COUNT);
+	list<Font> m_Fonts;
 	list<Text> m_Texts;
+	vector<TextCharacter> m_TextInstances;  // buffers of all texts, rebuilt when any of them changed
+	bool m_TextDirty = false;
 	// FIXME font memory is too strict and i don't think this is a nice approach in this case
 
 	// mesh
@@ -339,6 +737,7 @@ private:
 	list<ParticleBatch> m_DeferredParticleBatches;
 	list<lptr<GeometryBatch>> m_ShadowGeometryBatches;
 	list<lptr<ParticleBatch>> m_ShadowParticleBatches;
+	GeometryPool m_GeometryPool;
 
 	// lighting
 	lptr<ShaderPipeline> m_GeometryPassPipeline;
@@ -346,6 +745,32 @@ private:
 	lptr<ShaderPipeline> m_GeometryShadowPipeline;
 	lptr<ShaderPipeline> m_ParticleShadowPipeline;
 	Lighting m_Lighting;
+	list<PointLight> m_PointLights;
+
+	// light clustering, cluster headers, light indices & point lights share one buffer texture
+	TextureBuffer m_LightClusterBuffer;
+	vector<u32> m_LightClusterData;
+	vector<u32> m_LightClusterCounts;
+	vector<f32> m_LightViewX,m_LightViewY,m_LightViewZ,m_LightRadius;
+	vector<u8> m_LightClusterBounds;
+	s32 m_LightClusterLightOffset = 0;
+	bool m_LightClustersDirty = true;
+
+	// draw submission
+	RenderQueue m_ForwardQueue = RenderQueue(RENDERER_QUEUE_ORDER_BACK_TO_FRONT);
+	RenderQueue m_DeferredQueue;
+	RenderQueue m_ShadowQueue;
+	mat4 m_StaticShadowProjections[RENDERER_SHADOW_CASCADES];
+	u64 m_StaticShadowHash = 0;
+	BoundingSpheres m_ParticleSpheres;
+	vector<u8> m_ParticleVisible;
+	vector<u8> m_ParticleShadowVisible;
+
+	// uniform block state, as last written to gpu
+	CameraUniformBlock m_CameraBlockState = {};
+	ShadowUniformBlock m_ShadowBlockState = {};
+	LightingUniformBlock m_LightingBlockState = {};
+	bool m_LightingChanged = false;
 };
 
 inline Renderer g_Renderer = Renderer();
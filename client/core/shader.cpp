@@ -4,6 +4,23 @@
 // ----------------------------------------------------------------------------------------------------
 // Shaders
 
+// attribute format correlation maps, component type, normalization & byte width per component
+GLenum _attribute_format_type[] = { GL_FLOAT,GL_HALF_FLOAT,GL_UNSIGNED_SHORT,GL_INT_2_10_10_10_REV };
+GLboolean _attribute_format_normalized[] = { GL_FALSE,GL_FALSE,GL_TRUE,GL_TRUE };
+u8 _attribute_format_size[] = { 4,2,2,1 };
+
+/**
+ *	calculate attribute width within its raster
+ *	\param attrib: shader attribute
+ *	\returns width in bytes, padded to 4-byte alignment
+ *	NOTE packed formats always occupy 4 components in a single 4-byte word
+ */
+inline size_t _attribute_width(ShaderAttribute& attrib)
+{
+	if (attrib.format==SHADER_ATTRIBUTE_SNORM10) return 4;
+	return (attrib.dim*_attribute_format_size[attrib.format]+3)&~3;
+}
+
 /**
  *	compile given shader program
  *	\param path: path to shader program (can be vertex, fragment or geometry)
@@ -87,15 +104,23 @@ VertexShader::VertexShader(const char* path)
 		split_words(tokens,__Line);
 		tokens[2].pop_back();
 
-		// interpret input definition line
-		u8 dim = (tokens[1]=="float") ? 1 : tokens[1][3]-0x30;
-		write_head->push_back({ dim,tokens[2] });
-		(*width_head) += dim;
-	}
+		// interpret input definition line, matrices are mapped column by column
+		u8 dim = (tokens[1]=="float") ? 1 : (tokens[1]=="mat4") ? 16 : tokens[1][3]-0x30;
 
-	// convert widths to byte format
-	vbo_width *= SHADER_UPLOAD_VALUE_SIZE;
-	ibo_width *= SHADER_UPLOAD_VALUE_SIZE;
+		// optional packed memory format annotation, e.g. "in vec2 uv;  // engine: half"
+		ShaderAttributeFormat __Format = SHADER_ATTRIBUTE_FLOAT;
+		if (tokens.size()>5&&tokens[3]=="//"&&tokens[4]=="engine:")
+		{
+			if (tokens[5]=="half") __Format = SHADER_ATTRIBUTE_HALF;
+			else if (tokens[5]=="unorm16") __Format = SHADER_ATTRIBUTE_UNORM16;
+			else if (tokens[5]=="snorm10") __Format = SHADER_ATTRIBUTE_SNORM10;
+			COMM_ERR_COND(__Format==SHADER_ATTRIBUTE_FLOAT,"[SHADER] unknown attribute format %s",tokens[5].c_str());
+		}
+
+		// store attribute and extend upload width in bytes
+		write_head->push_back({ dim,tokens[2],__Format });
+		(*width_head) += _attribute_width(write_head->back());
+	}
 }
 
 /**
@@ -117,7 +142,7 @@ FragmentShader::FragmentShader(const char* path)
 	while(!__File.eof())
 	{
 		std::getline(__File,__Line);
-		if (__Line.find("uniform sampler2D")!=0) continue;
+		if (__Line.find("uniform ")!=0||__Line.find("sampler")==string::npos) continue;
 		else if (__Line.find("void main()")==0) break;
 
 		// extract sampler variables
@@ -132,6 +157,9 @@ FragmentShader::FragmentShader(const char* path)
 // ----------------------------------------------------------------------------------------------------
 // Pipelines
 
+// uniform block names correlating to UniformBlockBinding
+const char* _uniform_block_names[SHADER_BLOCK_COUNT] = { "CameraBlock","LightingBlock","ShadowBlock" };
+
 /**
  *	assemble shader pipeline from compiled shaders
  *	pipeline flow: vertex shader -> (geometry shader) -> fragment shader
@@ -148,7 +176,47 @@ void ShaderPipeline::assemble(VertexShader vs,FragmentShader fs)
 	m_ShaderProgram = glCreateProgram();
 	glAttachShader(m_ShaderProgram,vs.shader);
 	glAttachShader(m_ShaderProgram,fs.shader);
+
+	// bind attribute locations in declaration order, so pipelines with matching inputs can share vertex arrays
+	u32 __Location = 0;
+	for (ShaderAttribute& attrib : vs.vbo_attribs)
+	{
+		glBindAttribLocation(m_ShaderProgram,__Location,attrib.name.c_str());
+		__Location += (attrib.dim==16) ? 4 : 1;
+	}
+	m_InstanceLocation = __Location;
+	for (ShaderAttribute& attrib : vs.ibo_attribs)
+	{
+		glBindAttribLocation(m_ShaderProgram,__Location,attrib.name.c_str());
+		__Location += (attrib.dim==16) ? 4 : 1;
+	}
 	glLinkProgram(m_ShaderProgram);
+
+	// identify vertex layout by attribute raster, pipelines with equal layouts can share geometry memory
+	vector<u16> __Raster;
+	for (ShaderAttribute& attrib : vs.vbo_attribs) __Raster.push_back((attrib.dim<<8)|attrib.format);
+	m_VertexLayout = (__Raster.size()) ? hash_fnv1a(&__Raster[0],__Raster.size()*sizeof(u16)) : 0;
+
+	// map shared uniform blocks to their binding points
+	for (u8 i=0;i<SHADER_BLOCK_COUNT;i++)
+	{
+		u32 __BlockIndex = glGetUniformBlockIndex(m_ShaderProgram,_uniform_block_names[i]);
+		if (__BlockIndex!=GL_INVALID_INDEX) glUniformBlockBinding(m_ShaderProgram,__BlockIndex,i);
+	}
+	m_CameraBlock = glGetUniformBlockIndex(m_ShaderProgram,_uniform_block_names[SHADER_BLOCK_CAMERA])
+			!=GL_INVALID_INDEX;
+
+	// intern active uniform locations at link time
+	s32 __UniformCount;
+	glGetProgramiv(m_ShaderProgram,GL_ACTIVE_UNIFORMS,&__UniformCount);
+	for (s32 i=0;i<__UniformCount;i++)
+	{
+		char __Name[SHADER_UNIFORM_NAME_LENGTH];
+		s32 __Size;
+		GLenum __Type;
+		glGetActiveUniform(m_ShaderProgram,i,SHADER_UNIFORM_NAME_LENGTH,nullptr,&__Size,&__Type,__Name);
+		_intern_uniform(hash_fnv1a(__Name),__Name,glGetUniformLocation(m_ShaderProgram,__Name));
+	}
 }
 
 /**
@@ -188,23 +256,55 @@ void ShaderPipeline::enable() { glUseProgram(m_ShaderProgram); }
 void ShaderPipeline::disable() { glUseProgram(0); }
 
 /**
- *	extract uniform location from shader program
+ *	extract uniform location from shader program, names are resolved by the driver only once
  *	\param uname: literal uniform variable name in shader program
- *	\returns uniform location
+ *	\returns uniform location, -1 if uniform is not active in shader program
+ */
+s32 ShaderPipeline::get_uniform_location(const char* uname)
+{
+	u64 __Hash = hash_fnv1a(uname);
+	auto p_Location = m_UniformLocations.find(__Hash);
+	if (p_Location!=m_UniformLocations.end())
+	{
+#ifdef DEBUG
+		COMM_ERR_COND(m_UniformNames[__Hash]!=uname,"[SHADER] uniform names %s & %s collide in hash",
+					  uname,m_UniformNames[__Hash].c_str());
+#endif
+		return p_Location->second;
+	}
+
+	// first use of a name not reported at link time, e.g. array elements of basic types
+	s32 __Location = glGetUniformLocation(m_ShaderProgram,uname);
+	_intern_uniform(__Hash,uname,__Location);
+	return __Location;
+}
+
+/**
+ *	store uniform location by the hash of its name
+ *	\param hash: fnv1a hash of the uniform name
+ *	\param uname: uniform variable name, only kept in debug builds to report hash collisions
+ *	\param uloc: uniform location
  */
-u32 ShaderPipeline::get_uniform_location(const char* uname)
+void ShaderPipeline::_intern_uniform(u64 hash,const char* uname,s32 uloc)
 {
-	return glGetUniformLocation(m_ShaderProgram,uname);
+#ifdef DEBUG
+	auto p_Name = m_UniformNames.find(hash);
+	COMM_ERR_COND(p_Name!=m_UniformNames.end()&&p_Name->second!=uname,"[SHADER] uniform names %s & %s collide in hash",
+				  uname,p_Name->second.c_str());
+	m_UniformNames[hash] = uname;
+#endif
+	m_UniformLocations[hash] = uloc;
 }
 
 // uniform variable upload function correlation map
-typedef void (*uniform_upload)(u16,f32*);
-void _upload1f(u16 uloc,f32* data) { glUniform1f(uloc,data[0]); }
-void _upload2f(u16 uloc,f32* data) { glUniform2f(uloc,data[0],data[1]); }
-void _upload3f(u16 uloc,f32* data) { glUniform3f(uloc,data[0],data[1],data[2]); }
-void _upload4f(u16 uloc,f32* data) { glUniform4f(uloc,data[0],data[1],data[2],data[3]); }
-void _upload4m(u16 uloc,f32* data) { glUniformMatrix4fv(uloc,1,GL_FALSE,data); }
+typedef void (*uniform_upload)(s32,f32*);
+void _upload1f(s32 uloc,f32* data) { glUniform1f(uloc,data[0]); }
+void _upload2f(s32 uloc,f32* data) { glUniform2f(uloc,data[0],data[1]); }
+void _upload3f(s32 uloc,f32* data) { glUniform3f(uloc,data[0],data[1],data[2]); }
+void _upload4f(s32 uloc,f32* data) { glUniform4f(uloc,data[0],data[1],data[2],data[3]); }
+void _upload4m(s32 uloc,f32* data) { glUniformMatrix4fv(uloc,1,GL_FALSE,data); }
 uniform_upload uploadf[] = { _upload1f,_upload2f,_upload3f,_upload4f,_upload4m };
+size_t _uniform_dimension_size[] = { 1,2,3,4,16 };
 
 /**
  *	upload float uniform variable to shader by variable name
@@ -215,7 +315,7 @@ uniform_upload uploadf[] = { _upload1f,_upload2f,_upload3f,_upload4f,_upload4m }
  */
 void ShaderPipeline::upload(const char* varname,UniformDimension dim,f32* data)
 {
-	uploadf[dim](get_uniform_location(varname),data);
+	upload(get_uniform_location(varname),dim,data);
 }
 
 /**
@@ -225,29 +325,32 @@ void ShaderPipeline::upload(const char* varname,UniformDimension dim,f32* data)
  *	\param data: pointer to data, that will be uploaded to uniform variable
  *	NOTE shader pipeline needs to be active to upload values to uniform variables
  */
-void ShaderPipeline::upload(u16 uloc,UniformDimension dim,f32* data)
+void ShaderPipeline::upload(s32 uloc,UniformDimension dim,f32* data)
 {
-	uploadf[dim](uloc,data);
+	if (_cache_uniform(uloc,data,_uniform_dimension_size[dim]*sizeof(f32))) uploadf[dim](uloc,data);
 }
 
 /**
- *	upload uniform variable to shader
+ *	upload uniform variable to shader, values equal to the last upload are not sent again
  *	\param varname: variable name as defined as "uniform" in shader (must be part of the pipeline)
  *	\param value: value to upload to specified variable
  *	NOTE shader pipeline needs to be active to upload values to uniform variables
  */
 void ShaderPipeline::upload(const char* varname,s32 value)
-	{ glUniform1i(get_uniform_location(varname),value); }
+{
+	s32 __Location = get_uniform_location(varname);
+	if (_cache_uniform(__Location,&value,sizeof(s32))) glUniform1i(__Location,value);
+}
 void ShaderPipeline::upload(const char* varname,f32 value)
-	{ glUniform1f(get_uniform_location(varname),value); }
+	{ upload(varname,SHADER_UNIFORM_FLOAT,&value); }
 void ShaderPipeline::upload(const char* varname,vec2 value)
-	{ glUniform2f(get_uniform_location(varname),value.x,value.y); }
+	{ upload(varname,SHADER_UNIFORM_VEC2,&value.x); }
 void ShaderPipeline::upload(const char* varname,vec3 value)
-	{ glUniform3f(get_uniform_location(varname),value.x,value.y,value.z); }
+	{ upload(varname,SHADER_UNIFORM_VEC3,&value.x); }
 void ShaderPipeline::upload(const char* varname,vec4 value)
-	{ glUniform4f(get_uniform_location(varname),value.x,value.y,value.z,value.w); }
+	{ upload(varname,SHADER_UNIFORM_VEC4,&value.x); }
 void ShaderPipeline::upload(const char* varname,mat4 value)
-	{ glUniformMatrix4fv(get_uniform_location(varname),1,GL_FALSE,glm::value_ptr(value)); }
+	{ upload(varname,SHADER_UNIFORM_MAT44,glm::value_ptr(value)); }
 
 /**
  *	automatically upload the global 2D coordinate system to the shader
@@ -262,9 +365,11 @@ void ShaderPipeline::upload_coordinate_system()
 /**
  *	automatically upload the global 3D camera to the shader
  *	the camera is uploaded to uniforms view = "view", proj = "proj"
+ *	NOTE pipelines reading the camera from CameraBlock are fed once per frame by the renderer and skip this
  */
 void ShaderPipeline::upload_camera()
 {
+	if (m_CameraBlock) return;
 	upload("view",SHADER_UNIFORM_MAT44,glm::value_ptr(g_Camera.view));
 	upload("proj",SHADER_UNIFORM_MAT44,glm::value_ptr(g_Camera.proj));
 }
@@ -286,13 +391,12 @@ void ShaderPipeline::upload_camera(Camera3D& c)
  */
 void ShaderPipeline::_define_attribute(ShaderAttribute attrib)
 {
-	COMM_ERR_COND(m_VertexCursor+attrib.dim*SHADER_UPLOAD_VALUE_SIZE>m_VertexShader.vbo_width,
-				  "attribute dimension violates upload width");
+	size_t __Width = _attribute_width(attrib);
+	COMM_ERR_COND(m_VertexCursor+__Width>m_VertexShader.vbo_width,"attribute dimension violates upload width");
 
 	s32 __Attribute = _handle_attribute_location_by_name(attrib.name.c_str());
-	glVertexAttribPointer(__Attribute,attrib.dim,GL_FLOAT,GL_FALSE,
-						  m_VertexShader.vbo_width,(void*)m_VertexCursor);
-	m_VertexCursor += attrib.dim*SHADER_UPLOAD_VALUE_SIZE;
+	_point_attribute(__Attribute,attrib,m_VertexShader.vbo_width,m_VertexCursor);
+	m_VertexCursor += __Width;
 }
 
 /**
@@ -302,14 +406,61 @@ void ShaderPipeline::_define_attribute(ShaderAttribute attrib)
  */
 void ShaderPipeline::_define_index_attribute(ShaderAttribute attrib)
 {
-	COMM_ERR_COND(m_IndexCursor+attrib.dim*SHADER_UPLOAD_VALUE_SIZE>m_VertexShader.ibo_width,
-				  "index dimension violates upload width");
+	size_t __Width = _attribute_width(attrib);
+	COMM_ERR_COND(m_IndexCursor+__Width>m_VertexShader.ibo_width,"index dimension violates upload width");
 
 	s32 __Attribute = _handle_attribute_location_by_name(attrib.name.c_str());
-	glVertexAttribPointer(__Attribute,attrib.dim,GL_FLOAT,GL_FALSE,
-						  m_VertexShader.ibo_width,(void*)m_IndexCursor);
-	glVertexAttribDivisor(__Attribute,1);
-	m_IndexCursor += attrib.dim*SHADER_UPLOAD_VALUE_SIZE;
+	_point_attribute(__Attribute,attrib,m_VertexShader.ibo_width,m_IndexCursor);
+	for (u8 i=0;i<((attrib.dim==16) ? 4 : 1);i++) glVertexAttribDivisor(__Attribute+i,1);
+	m_IndexCursor += __Width;
+}
+
+/**
+ *	compare uniform value to shadow copy of the last upload and update the copy
+ *	\param uloc: uniform location
+ *	\param data: pointer to value memory
+ *	\param size: value width in bytes
+ *	\returns true if value differs from the last upload and has to be sent to the gpu
+ */
+bool ShaderPipeline::_cache_uniform(s32 uloc,void* data,size_t size)
+{
+	if (uloc<0) return false;
+	if ((size_t)uloc>=m_UniformCache.size()) m_UniformCache.resize(uloc+1);
+
+	// compare with last upload
+	UniformCache& p_Cache = m_UniformCache[uloc];
+	if (p_Cache.valid&&!memcmp(p_Cache.value,data,size)) return false;
+	memcpy(p_Cache.value,data,size);
+	p_Cache.valid = true;
+	return true;
+}
+
+/**
+ *	point attribute location to its raster in the active buffer
+ *	\param location: attribute location
+ *	\param attrib: shader attribute structure
+ *	\param width: upload width of a full raster in bytes
+ *	\param offset: attribute offset within the raster in bytes
+ *	NOTE mat4 attributes occupy four consecutive locations, one per column
+ */
+void ShaderPipeline::_point_attribute(s32 location,ShaderAttribute& attrib,size_t width,size_t offset)
+{
+	if (attrib.dim!=16)
+	{
+		u8 __Components = (attrib.format==SHADER_ATTRIBUTE_SNORM10) ? 4 : attrib.dim;
+		glVertexAttribPointer(location,__Components,_attribute_format_type[attrib.format],
+							  _attribute_format_normalized[attrib.format],width,(void*)offset);
+		return;
+	}
+
+	// split matrix into column vectors
+	size_t __Column = 4*_attribute_format_size[attrib.format];
+	for (u8 i=0;i<4;i++)
+	{
+		glEnableVertexAttribArray(location+i);
+		glVertexAttribPointer(location+i,4,_attribute_format_type[attrib.format],
+							  _attribute_format_normalized[attrib.format],width,(void*)(offset+i*__Column));
+	}
 }
 
 /**
@@ -7,13 +7,22 @@
 
 
 constexpr u32 SHADER_ERROR_LOGGING_LENGTH = 512;
-constexpr size_t SHADER_UPLOAD_VALUE_SIZE = sizeof(float);
+constexpr u32 SHADER_UNIFORM_NAME_LENGTH = 128;
 
 
+enum ShaderAttributeFormat : u8
+{
+	SHADER_ATTRIBUTE_FLOAT,
+	SHADER_ATTRIBUTE_HALF,
+	SHADER_ATTRIBUTE_UNORM16,
+	SHADER_ATTRIBUTE_SNORM10  // signed normalized 10-bit xyz & 2-bit w, packed into 4 bytes
+};
+
 struct ShaderAttribute
 {
 	u8 dim;
 	string name;
+	ShaderAttributeFormat format = SHADER_ATTRIBUTE_FLOAT;
 };
 
 class Shader
@@ -52,6 +61,15 @@ public:
 };
 
 
+// uniform block binding points, blocks are mapped by name through _uniform_block_names
+enum UniformBlockBinding : u8
+{
+	SHADER_BLOCK_CAMERA,
+	SHADER_BLOCK_LIGHTING,
+	SHADER_BLOCK_SHADOW,
+	SHADER_BLOCK_COUNT
+};
+
 enum UniformDimension : u8
 {
 	SHADER_UNIFORM_FLOAT,
@@ -61,6 +79,12 @@ enum UniformDimension : u8
 	SHADER_UNIFORM_MAT44
 };
 
+struct UniformCache
+{
+	f32 value[16];
+	bool valid = false;
+};
+
 class ShaderPipeline
 {
 public:
@@ -71,11 +95,16 @@ public:
 	// usage
 	void enable();
 	static void disable();
-	u32 get_uniform_location(const char* uname);
+	s32 get_uniform_location(const char* uname);
+	inline u32 get_id() { return m_ShaderProgram; }
+	inline size_t get_vertex_width() { return m_VertexShader.vbo_width; }
+	inline size_t get_instance_width() { return m_VertexShader.ibo_width; }
+	inline u32 get_instance_location() { return m_InstanceLocation; }
+	inline u64 get_vertex_layout() { return m_VertexLayout; }
 
 	// upload
 	void upload(const char* varname,UniformDimension dim,f32* data);
-	void upload(u16 uloc,UniformDimension dim,f32* data);
+	void upload(s32 uloc,UniformDimension dim,f32* data);
 	void upload(const char* varname,s32 value);
 	void upload(const char* varname,f32 value);
 	void upload(const char* varname,vec2 value);
@@ -91,14 +120,27 @@ public:
 	// TODO change back to references
 private:
 	s32 _handle_attribute_location_by_name(const char* varname);
+	void _point_attribute(s32 location,ShaderAttribute& attrib,size_t width,size_t offset);
+	bool _cache_uniform(s32 uloc,void* data,size_t size);
+	void _intern_uniform(u64 hash,const char* uname,s32 uloc);
 
 private:
 
 	// program
 	u32 m_ShaderProgram;
+	bool m_CameraBlock = false;
+	u32 m_InstanceLocation = 0;
+	u64 m_VertexLayout = 0;
 	VertexShader m_VertexShader;
 	FragmentShader m_FragmentShader;
 
+	// uniform state, interned names & shadow copy of uploaded values indexed by location
+	std::unordered_map<u64,s32> m_UniformLocations;
+	vector<UniformCache> m_UniformCache;
+#ifdef DEBUG
+	std::unordered_map<u64,string> m_UniformNames;  // names by hash, to detect colliding uniform names
+#endif
+
 	// working iteration
 	size_t m_VertexCursor = 0;
 	size_t m_IndexCursor = 0;
@@ -6,18 +6,29 @@ in vec3 Normal;
 in vec3 Colour;
 in vec2 Material;
 
-layout(location = 0) out vec4 gbuffer_colour;
-layout(location = 1) out vec4 gbuffer_position;
-layout(location = 2) out vec4 gbuffer_normals;
-layout(location = 3) out vec4 gbuffer_materials;
-layout(location = 4) out vec4 gbuffer_emission;
+layout(location = 0) out vec4 gbuffer_colour;  // albedo, metalness
+layout(location = 1) out vec2 gbuffer_normals;
+layout(location = 2) out float gbuffer_materials;  // roughness
+layout(location = 3) out vec4 gbuffer_emission;  // emission, occlusion
+
+
+// utility
+vec2 encode_normal(vec3 n);
 
 
 void main()
 {
-	gbuffer_colour = vec4(0,0,0,1);
-	gbuffer_position = vec4(Position,1);
-	gbuffer_normals = vec4(Normal,1);
-	gbuffer_materials = vec4(0,.4,1,1);
+	gbuffer_colour = vec4(0,0,0,0);
+	gbuffer_normals = encode_normal(normalize(Normal));
+	gbuffer_materials = .4;
 	gbuffer_emission = vec4(Colour,1);
 }
+
+// octahedron encoding of unit vectors into two channels in 0 to 1 range
+// NOTE duplicated in gpass.frag, ipass.frag & bulb.frag, copies must stay identical & match decode_normal in pbs.frag
+vec2 encode_normal(vec3 n)
+{
+	n /= abs(n.x)+abs(n.y)+abs(n.z);
+	vec2 e = (n.z>=.0) ? n.xy : (1.-abs(n.yx))*vec2(n.x>=.0 ? 1. : -1.,n.y>=.0 ? 1. : -1.);
+	return e*.5+.5;
+}
@@ -5,11 +5,10 @@ in vec3 Position;
 in vec2 EdgeCoordinates;
 in mat3 TBN;
 
-layout(location = 0) out vec4 gbuffer_colour;
-layout(location = 1) out vec4 gbuffer_position;
-layout(location = 2) out vec4 gbuffer_normals;
-layout(location = 3) out vec4 gbuffer_materials;
-layout(location = 4) out vec4 gbuffer_emission;
+layout(location = 0) out vec4 gbuffer_colour;  // albedo, metalness
+layout(location = 1) out vec2 gbuffer_normals;
+layout(location = 2) out float gbuffer_materials;  // roughness
+layout(location = 3) out vec4 gbuffer_emission;  // emission, occlusion
 
 uniform sampler2D colour_map;
 uniform sampler2D normal_map;
@@ -17,18 +16,29 @@ uniform sampler2D material_map;
 uniform sampler2D emission_map;
 
 
+// utility
+vec2 encode_normal(vec3 n);
+
+
 void main()
 {
-	// extract colour & position
-	gbuffer_colour = vec4(texture(colour_map,EdgeCoordinates).rgb,1.);
-	gbuffer_position = vec4(Position,1.);
-
-	// translate normals
-	vec3 normals = texture(normal_map,EdgeCoordinates).rgb*2.0-1.0;
-	gbuffer_normals = vec4(normalize(TBN*normals),1.);
+	// extract colour & surface materials, position is reconstructed from depth
+	vec3 material = texture(material_map,EdgeCoordinates).rgb;
+	gbuffer_colour = vec4(texture(colour_map,EdgeCoordinates).rgb,material.r);
+	gbuffer_materials = material.g;
+
+	// translate normals, z is reconstructed from the two stored components
+	vec2 planar = texture(normal_map,EdgeCoordinates).rg*2.0-1.0;
+	vec3 normals = vec3(planar,sqrt(max(1.0-dot(planar,planar),.0)));
+	gbuffer_normals = encode_normal(normalize(TBN*normals));
+	gbuffer_emission = vec4(texture(emission_map,EdgeCoordinates).rgb,material.b);
+}
 
-	// extract surface materials
-	gbuffer_materials = vec4(texture(material_map,EdgeCoordinates).rgb,1.);
-	gbuffer_emission = vec4(texture(emission_map,EdgeCoordinates).rgb,1.);
+// octahedron encoding of unit vectors into two channels in 0 to 1 range
+// NOTE duplicated in gpass.frag, ipass.frag & bulb.frag, copies must stay identical & match decode_normal in pbs.frag
+vec2 encode_normal(vec3 n)
+{
+	n /= abs(n.x)+abs(n.y)+abs(n.z);
+	vec2 e = (n.z>=.0) ? n.xy : (1.-abs(n.yx))*vec2(n.x>=.0 ? 1. : -1.,n.y>=.0 ? 1. : -1.);
+	return e*.5+.5;
 }
-// FIXME alpha values are completely unused here, this should be abused!
@@ -1,20 +1,25 @@
 #version 330 core
 
 
-in vec3 position;
-in vec2 edge_coordinates;
-in vec3 normals;
-in vec3 tangent;
+in vec3 position;  // engine: half
+in vec2 edge_coordinates;  // engine: unorm16
+in vec3 normals;  // engine: snorm10
+in vec3 tangent;  // engine: snorm10
+
+// engine: ibo
+in mat4 model;
+in float texel;
 
 out vec3 Position;
 out vec2 EdgeCoordinates;
 out mat3 TBN;
 
-uniform mat4 view;
-uniform mat4 proj;
-
-uniform mat4 model;
-uniform float texel = 1.;
+layout(std140) uniform CameraBlock
+{
+	mat4 view;
+	mat4 proj;
+	vec3 camera_position;
+};
 
 
 void main()
@@ -1,18 +1,25 @@
 #version 330 core
 
 
-in vec3 position;
-in vec2 edge_coordinates;
-in vec3 normals;
-in vec3 tangent;
+in vec3 position;  // engine: half
+in vec2 edge_coordinates;  // engine: unorm16
+in vec3 normals;  // engine: snorm10
+in vec3 tangent;  // engine: snorm10
 
-uniform mat4 view;
-uniform mat4 proj;
+// engine: ibo
+in mat4 model;
+in float texel;
 
-uniform mat4 model;
+layout(std140) uniform ShadowBlock
+{
+	mat4 shadow_projection[8];
+	vec3 shadow_source;
+	int shadow_cascades;
+};
+uniform int shadow_cascade = 0;
 
 
 void main()
 {
-	gl_Position = proj*view*model*vec4(position,1.);
+	gl_Position = shadow_projection[shadow_cascade]*model*vec4(position,1.);
 }
@@ -1,10 +1,10 @@
 #version 330 core
 
 
-in vec3 position;
-in vec2 uv;
-in vec3 normal;
-in vec3 tangent;
+in vec3 position;  // engine: half
+in vec2 uv;  // engine: unorm16
+in vec3 normal;  // engine: snorm10
+in vec3 tangent;  // engine: snorm10
 
 // engine: ibo
 in vec3 offset;
@@ -19,8 +19,12 @@ out vec3 Normal;
 out vec3 Colour;
 out vec2 Material;
 
-uniform mat4 view;
-uniform mat4 proj;
+layout(std140) uniform CameraBlock
+{
+	mat4 view;
+	mat4 proj;
+	vec3 camera_position;
+};
 
 
 void main()
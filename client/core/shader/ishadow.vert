@@ -1,10 +1,10 @@
 #version 330 core
 
 
-in vec3 position;
-in vec2 uv;
-in vec3 normal;
-in vec3 tangent;
+in vec3 position;  // engine: half
+in vec2 uv;  // engine: unorm16
+in vec3 normal;  // engine: snorm10
+in vec3 tangent;  // engine: snorm10
 
 // engine: ibo
 in vec3 offset;
@@ -17,8 +17,13 @@ out vec3 Normal;
 out vec3 Colour;
 out vec2 Material;
 
-uniform mat4 view;
-uniform mat4 proj;
+layout(std140) uniform ShadowBlock
+{
+	mat4 shadow_projection[8];
+	vec3 shadow_source;
+	int shadow_cascades;
+};
+uniform int shadow_cascade = 0;
 
 
 void main()
@@ -27,5 +32,5 @@ void main()
 	Normal = normal;
 	Colour = colour;
 	Material = material;
-	gl_Position = proj*view*vec4(Position,1.);
+	gl_Position = shadow_projection[shadow_cascade]*vec4(Position,1.);
 }
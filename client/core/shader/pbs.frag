@@ -12,6 +12,7 @@ struct light_sun
 struct light_point
 {
 	vec3 position;
+	float radius;
 	vec3 colour;
 	float constant;
 	float linear;
@@ -25,28 +26,45 @@ layout(location = 0) out vec4 pixelColour;
 
 uniform sampler2D forward_target;
 uniform sampler2D gbuffer_colour;
-uniform sampler2D gbuffer_position;
 uniform sampler2D gbuffer_normal;
 uniform sampler2D gbuffer_material;
 uniform sampler2D gbuffer_emission;
 uniform sampler2D shadow_map;
 uniform sampler2D forward_depth;
 uniform sampler2D gbuffer_depth;
+uniform usamplerBuffer light_clusters;
 
 // camera parameters
-uniform vec3 camera_position;
+layout(std140) uniform CameraBlock
+{
+	mat4 view;
+	mat4 proj;
+	vec3 camera_position;
+};
+uniform mat4 view_projection_inverse;
+uniform vec2 resolution_scale = vec2(1.);
 uniform float exposure = 1.;
 uniform float gamma = 1./2.2;
 
 // simulated lights
-uniform light_sun sunlights[8];
-uniform light_point pointlights[64];
-uniform int sunlights_active = 0;
-uniform int pointlights_active = 0;
+layout(std140) uniform LightingBlock
+{
+	light_sun sunlights[8];
+	int sunlights_active;
+};
+
+// clustered point lights
+uniform vec3 cluster_grid;
+uniform vec2 cluster_depth;
+uniform int cluster_lights;
 
 // shadows
-uniform vec3 shadow_source;
-uniform mat4 shadow_projection;
+layout(std140) uniform ShadowBlock
+{
+	mat4 shadow_projection[8];
+	vec3 shadow_source;
+	int shadow_cascades;
+};
 uniform float shadow_intensity = .9;
 
 // constants
@@ -56,6 +74,9 @@ const float PI = 3.141592653;
 // utility
 vec3 lumen_sun(vec3 position,vec3 colour,vec3 normal,float metallic,float roughness,light_sun light);
 vec3 lumen_point(vec3 position,vec3 colour,vec3 normal,float metallic,float roughness,light_point light);
+light_point fetch_point(uint index);
+vec3 decode_position(float depth);
+vec3 decode_normal(vec2 e);
 vec3 pbs(vec3 colour,vec3 direction,vec3 influence,vec3 normal,vec3 halfway,float metallic,float roughness);
 float schlick_beckmann_approx(float rel,float roughness);
 
@@ -69,23 +90,23 @@ float SchlickOut;
 
 void main()
 {
-	// map buffer components
-	vec4 cmp_forward = texture(forward_target,EdgeCoordinates);
-	vec4 cmp_colour = texture(gbuffer_colour,EdgeCoordinates);
-	vec4 cmp_position = texture(gbuffer_position,EdgeCoordinates);
-	vec4 cmp_normal = texture(gbuffer_normal,EdgeCoordinates);
-	vec4 cmp_material = texture(gbuffer_material,EdgeCoordinates);
-	vec4 cmp_emission = texture(gbuffer_emission,EdgeCoordinates);
-	float cmp_fdepth = texture(forward_depth,EdgeCoordinates).r;
-	float cmp_gdepth = texture(gbuffer_depth,EdgeCoordinates).r;
+	// map buffer components, the 3D segment only covers the dynamically scaled region of its targets
+	vec2 target = EdgeCoordinates*resolution_scale;
+	vec4 cmp_forward = texture(forward_target,target);
+	vec4 cmp_colour = texture(gbuffer_colour,target);
+	vec2 cmp_normal = texture(gbuffer_normal,target).rg;
+	float cmp_material = texture(gbuffer_material,target).r;
+	vec4 cmp_emission = texture(gbuffer_emission,target);
+	float cmp_fdepth = texture(forward_depth,target).r;
+	float cmp_gdepth = texture(gbuffer_depth,target).r;
 
 	// translating buffer information
 	vec3 colour = cmp_colour.rgb;
-	vec3 position = cmp_position.rgb;
-	vec3 normal = cmp_normal.rgb;
-	float metalness = cmp_material.r;
-	float roughness = cmp_material.g;
-	float occlusion = cmp_material.b;
+	vec3 position = decode_position(cmp_gdepth);
+	vec3 normal = decode_normal(cmp_normal);
+	float metalness = cmp_colour.a;
+	float roughness = cmp_material;
+	float occlusion = cmp_emission.a;
 	vec3 emission = cmp_emission.rgb;
 
 	// precalculate pixel parameters
@@ -100,17 +121,36 @@ void main()
 	vec3 lgt_component = vec3(0);
 	for (int i=0;i<sunlights_active;i++)
 		sdw_component += lumen_sun(position,colour,normal,metalness,roughness,sunlights[i]);
-	for (int i=0;i<pointlights_active;i++)
-		lgt_component += lumen_point(position,colour,normal,metalness,roughness,pointlights[i]);
+
+	// only shade pointlights assigned to the pixel's view cluster
+	float depth = max(-(view*vec4(position,1.)).z,1e-4);
+	ivec3 cluster = ivec3(min(EdgeCoordinates*cluster_grid.xy,cluster_grid.xy-1.),
+						  clamp((log(depth)-cluster_depth.x)*cluster_depth.y,0.,cluster_grid.z-1.));
+	uvec4 header = texelFetch(light_clusters,
+							  (cluster.z*int(cluster_grid.y)+cluster.y)*int(cluster_grid.x)+cluster.x);
+	for (uint i=0u;i<header.y;i++)
+	{
+		uint offset = header.x+i;
+		uint index = texelFetch(light_clusters,int(offset>>2u))[offset&3u];
+		lgt_component += lumen_point(position,colour,normal,metalness,roughness,fetch_point(index));
+	}
 
 	// process shadows with dynamic bias for sloped surfaces
 	vec3 shadow_dir = normalize(shadow_source);
-	vec4 rltp = shadow_projection*vec4(position,1.);
-	vec3 ltp = (rltp.xyz/rltp.w)*.5+.5;
-	float slut = texture(shadow_map,ltp.xy).r;
-	float obj_depth = ltp.z;
-	float bias = tan(acos(dot(normal,shadow_dir)))*.00001;
-	float pshadow = float(slut<(obj_depth-bias));
+	float bias = clamp(tan(acos(dot(normal,shadow_dir)))*.0005,.0,.01);
+	float pshadow = .0;
+	for (int i=0;i<shadow_cascades;i++)
+	{
+		// cascades are ordered by distance, the first cascade containing the position is the sharpest
+		vec4 rltp = shadow_projection[i]*vec4(position,1.);
+		vec3 ltp = (rltp.xyz/rltp.w)*.5+.5;
+		if (any(lessThan(ltp,vec3(0)))||any(greaterThan(ltp,vec3(1)))) continue;
+
+		// cascades are placed side by side within the shadow map
+		float slut = texture(shadow_map,vec2((float(i)+ltp.x)/float(shadow_cascades),ltp.y)).r;
+		pshadow = float(slut<(ltp.z-bias));
+		break;
+	}
 	float gshadow = min(1.-dot(normal,shadow_dir),1.);
 	float shadow = max(pshadow,gshadow);
 	//float shadow = mix(float(texture(shadow_map,ltp.xy).r<(obj_depth-bias)),.0,gshadow);
@@ -146,15 +186,44 @@ vec3 lumen_point(vec3 position,vec3 colour,vec3 normal,float metallic,float roug
 	vec3 direction = normalize(relation);
 	vec3 halfway = normalize(CameraDir+direction);
 
-	// calculate influence
+	// calculate influence, windowed to reach zero at the light's cluster radius
 	float dist = length(relation);
-	float attenuation = 1./(light.constant+light.linear*dist+light.quadratic*pow(dist,2.));
+	float window = pow(clamp(1.-pow(dist/light.radius,4.),.0,1.),2.);
+	float attenuation = window/(light.constant+light.linear*dist+light.quadratic*pow(dist,2.));
 	vec3 influence = light.colour*attenuation;
 
 	// shade & return
 	return pbs(colour,direction,influence,normal,halfway,metallic,roughness);
 }
 
+// reconstruct world position from the depth buffer
+vec3 decode_position(float depth)
+{
+	vec4 position = view_projection_inverse*vec4(vec3(EdgeCoordinates,depth)*2.-1.,1.);
+	return position.xyz/position.w;
+}
+
+// invert octahedron encoding of the normal buffer
+// NOTE inverts encode_normal, which is duplicated in gpass.frag, ipass.frag & bulb.frag, keep all in sync
+vec3 decode_normal(vec2 e)
+{
+	e = e*2.-1.;
+	vec3 n = vec3(e,1.-abs(e.x)-abs(e.y));
+	float fold = max(-n.z,.0);
+	n.xy += vec2(n.x>=.0 ? -fold : fold,n.y>=.0 ? -fold : fold);
+	return normalize(n);
+}
+
+// read point light from its texels in the cluster buffer
+light_point fetch_point(uint index)
+{
+	int texel = cluster_lights+int(index)*3;
+	vec4 t0 = uintBitsToFloat(texelFetch(light_clusters,texel));
+	vec4 t1 = uintBitsToFloat(texelFetch(light_clusters,texel+1));
+	vec4 t2 = uintBitsToFloat(texelFetch(light_clusters,texel+2));
+	return light_point(t0.xyz,t0.w,t1.xyz,t1.w,t2.x,t2.y);
+}
+
 // shade function for physically defined objects
 vec3 pbs(vec3 colour,vec3 direction,vec3 influence,vec3 normal,vec3 halfway,float metallic,float roughness)
 {
@@ -7,10 +7,9 @@ in vec2 edge_coordinates;
 // engine: ibo
 in vec3 offset;
 in vec2 scale;
-in float rotation;
-in float alpha;
-in vec2 tex_position;
-in vec2 tex_dimension;
+in vec2 rotation_alpha;  // engine: half
+in vec2 tex_position;  // engine: unorm16
+in vec2 tex_dimension;  // engine: unorm16
 
 out vec2 EdgeCoordinates;
 out float Alpha;
@@ -22,7 +21,7 @@ uniform mat4 proj;
 void main()
 {
 	// sprite rotation
-	float rd_rotation = radians(rotation);
+	float rd_rotation = radians(rotation_alpha.x);
 	float rotation_sin = sin(rd_rotation);
 	float rotation_cos = cos(rd_rotation);
 	vec2 Position = mat2(rotation_cos,-rotation_sin,rotation_sin,rotation_cos)*position;
@@ -30,5 +29,5 @@ void main()
 
 	// pass
 	EdgeCoordinates = tex_position+tex_dimension*edge_coordinates;
-	Alpha = alpha;
+	Alpha = rotation_alpha.y;
 }
@@ -11,5 +11,8 @@ uniform sampler2D tex;
 
 void main()
 {
-	pixelColour = Colour*texture(tex,EdgeCoordinates).r;
+	// signed distance field, the outline is at .5 & antialiased over the screen space rate of change
+	float Distance = texture(tex,EdgeCoordinates).r;
+	float Smoothing = fwidth(Distance)*.5;
+	pixelColour = Colour*smoothstep(.5-Smoothing,.5+Smoothing,Distance);
 }
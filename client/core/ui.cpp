@@ -36,7 +36,7 @@ void Button::update()
  */
 void Button::remove()
 {
-	Renderer::delete_sprite(canvas);
+	g_Renderer.delete_sprite(canvas);
 	g_Renderer.delete_text(label);
 }
 
@@ -70,15 +70,20 @@ void TextField::update(Font* font,Sprite* cursor,bool& field_switch,bool& tynext
 		}
 		else
 		{
-			content->data = (!hidden) ? buffer : string(buffer.size(),'*');
-			content->align();
-			content->load_buffer();
+			if (!hidden) content->data = buffer;
+			else content->data.assign(buffer.size(),'*');
+			content->update();
 		}
 
 		// handle keyboard input
 		cnf_input = g_Input.keyboard.triggered_keys[SDL_SCANCODE_RETURN];
-		cursor_rev += g_Input.keyboard.triggered_keys[SDL_SCANCODE_LEFT]
+		s32 __Step = g_Input.keyboard.triggered_keys[SDL_SCANCODE_LEFT]
 				- g_Input.keyboard.triggered_keys[SDL_SCANCODE_RIGHT];
+		cursor_rev += __Step;
+
+		// step over continuation bytes, so the cursor never splits a utf-8 encoded codepoint
+		while (__Step&&cursor_rev>0&&cursor_rev<(s32)buffer.size()&&(buffer[buffer.size()-cursor_rev]&0xc0)==0x80)
+			cursor_rev += __Step;
 		cursor_rev = (g_Input.keyboard.triggered_keys[SDL_SCANCODE_HOME]) ? buffer.size() : cursor_rev;
 		cursor_rev = (g_Input.keyboard.triggered_keys[SDL_SCANCODE_END]) ? 0 : cursor_rev;
 		cursor_rev = glm::clamp(cursor_rev,0,(s32)buffer.size());
@@ -120,7 +125,7 @@ void TextField::update(Font* font,Sprite* cursor,bool& field_switch,bool& tynext
  */
 void TextField::remove()
 {
-	Renderer::delete_sprite(canvas);
+	g_Renderer.delete_sprite(canvas);
 	g_Renderer.delete_text(content);
 }
 
@@ -231,7 +236,7 @@ void UI::update()
 	*/
 	// TODO make this the actual smooth blinking as soon as autoorder for 2D sprites is fixed
 
-	// update cursor animation (hard)
+	// update cursor animation (hard), placed by the active text field
 	m_CursorSprite->offset = vec3(1)-vec3(-100)*vec3(m_CursorAnim>1.f);
 	m_CursorAnim += UI_CURSOR_BLINK_DELTA;
 	m_CursorAnim = fmod(m_CursorAnim,2.f);
@@ -251,6 +256,12 @@ void UI::update()
 			p_TextField.update(p_Batch.font,m_CursorSprite,__SwitchedFields,__TabNext,__ConfirmInput);
 		p_Batch.buttons.begin()->confirm |= __ConfirmInput;
 	}
+
+	// upload cursor only when blinking or placement changed its final state
+	if (m_CursorSprite->offset==m_CursorOffset&&m_CursorSprite->scale==m_CursorScale) return;
+	m_CursorOffset = m_CursorSprite->offset;
+	m_CursorScale = m_CursorSprite->scale;
+	g_Renderer.update_sprite(m_CursorSprite);
 }
 
 /**
@@ -86,6 +86,8 @@ private:
 
 	// cursor
 	Sprite* m_CursorSprite;
+	vec3 m_CursorOffset = vec3(-100);  // last uploaded cursor placement
+	vec2 m_CursorScale = vec2(2,50);
 	f32 m_CursorAnim = .0f;
 };
 
@@ -18,7 +18,7 @@
 
 s32 main(s32 argc,char** argv)
 {
-	Font* __Ubuntu = g_Renderer.register_font("./res/font/ubuntu.ttf",20);
+	Font* __Ubuntu = g_Renderer.register_font("./res/font/ubuntu.ttf");
 	/*
 	StarSystem __StarSystem = StarSystem();
 	Flotilla __Flotilla = Flotilla();
@@ -49,8 +49,7 @@ void CameraController::update()
 
 	// fps display
 #ifdef DEBUG
-	m_FPS->data = "FPS "+std::to_string(g_Frame.fps);
-	m_FPS->align();
-	m_FPS->load_buffer();
+	m_FPS->print("FPS %u",g_Frame.fps);
+	m_FPS->update();
 #endif
 }
@@ -79,7 +79,7 @@ void CommandCenter::update()
 	{
 		if (i<m_Flotilla->fleet.size())
 		{
-			m_BtnFleet[i]->label->data = "Ship "+std::to_string(m_Flotilla->fleet[i].id);
+			m_BtnFleet[i]->label->print("Ship %" PRIu64,(u64)m_Flotilla->fleet[i].id);
 			if (m_BtnFleet[i]->confirm)
 			{
 				m_ShipLock = i;
@@ -88,9 +88,8 @@ void CommandCenter::update()
 				_set_text_flight();
 			}
 		}
-		else m_BtnFleet[i]->label->data = "Free Ship Slot";
-		m_BtnFleet[i]->label->align();
-		m_BtnFleet[i]->label->load_buffer();
+		else m_BtnFleet[i]->label->print("Free Ship Slot");
+		m_BtnFleet[i]->label->update();
 	}
 
 	// control mode
@@ -162,9 +161,8 @@ void CommandCenter::_set_planet_buttons(string instr)
 {
 	for (u8 i=0;i<8;i++)
 	{
-		m_BtnJumpers[i]->label->data = instr+m_PlanetNames[i];
-		m_BtnJumpers[i]->label->align();
-		m_BtnJumpers[i]->label->load_buffer();
+		m_BtnJumpers[i]->label->print("%s%s",instr.c_str(),m_PlanetNames[i].c_str());
+		m_BtnJumpers[i]->label->update();
 	}
 }
 // TODO this is an unfortunate born from immense time pressure. this can be cleaned up!
@@ -174,10 +172,9 @@ void CommandCenter::_set_planet_buttons(string instr)
  */
 void CommandCenter::_set_text_locked()
 {
-	m_TxControlMode->data = "Orbiting "+m_PlanetNames[m_PlanetLock];
+	m_TxControlMode->print("Orbiting %s",m_PlanetNames[m_PlanetLock].c_str());
 	m_TxControlMode->colour = vec4(.5f,0,0,1);
-	m_TxControlMode->align();
-	m_TxControlMode->load_buffer();
+	m_TxControlMode->update();
 }
 
 /**
@@ -185,12 +182,10 @@ void CommandCenter::_set_text_locked()
  */
 void CommandCenter::_set_text_flight()
 {
-	m_TxControlMode->data = "Flying Spaceship "+std::to_string(m_Flotilla->fleet[m_ShipLock].id)
-															   +" -> [TAB] to go back to "
-															   +m_PlanetNames[m_PlanetLock];
+	m_TxControlMode->print("Flying Spaceship %" PRIu64 " -> [TAB] to go back to %s",(u64)m_Flotilla->fleet[m_ShipLock].id,
+						   m_PlanetNames[m_PlanetLock].c_str());
 	m_TxControlMode->colour = vec4(0,.5f,0,1);
-	m_TxControlMode->align();
-	m_TxControlMode->load_buffer();
+	m_TxControlMode->update();
 }
 
 /**
@@ -198,10 +193,9 @@ void CommandCenter::_set_text_flight()
  */
 void CommandCenter::_set_text_freeform()
 {
-	m_TxControlMode->data = "System Exploration Mode -> [TAB] to jump to "+m_PlanetNames[m_PlanetLock];
+	m_TxControlMode->print("System Exploration Mode -> [TAB] to jump to %s",m_PlanetNames[m_PlanetLock].c_str());
 	m_TxControlMode->colour = vec4(0,0,.5f,1);
-	m_TxControlMode->align();
-	m_TxControlMode->load_buffer();
+	m_TxControlMode->update();
 }
 
 
@@ -31,7 +31,6 @@ Flotilla::Flotilla()
 void Flotilla::update()
 {
 	// upload fleet
-	m_SpaceshipBatch->active_particles = spaceships.size();
 	for (u32 i=0;i<spaceships.size();i++)
 	{
 		spaceships[i].scale = 1;
@@ -39,9 +38,8 @@ void Flotilla::update()
 		// TODO this can be a uniform upload !!BLAZINGLY FAAST!!
 	}
 
-	// update fleet positions
-	m_SpaceshipBatch->ibo.bind();
-	m_SpaceshipBatch->ibo.upload_vertices(spaceships,GL_DYNAMIC_DRAW);
+	// update fleet positions, ships outside of view are culled by the renderer
+	m_SpaceshipBatch->upload_instances(spaceships.data(),spaceships.size());
 }
 
 
@@ -21,13 +21,13 @@ PlanetFocus::PlanetFocus(Font* font)
 	// textures
 	vector<Texture*> __EarthTextures = {
 		g_Renderer.register_texture("./res/planets/earth.jpg",TEXTURE_FORMAT_SRGB),
-		g_Renderer.register_texture("./res/planets/earth_normal.png"),
+		g_Renderer.register_texture("./res/planets/earth_normal.png",TEXTURE_FORMAT_NORMAL),
 		g_Renderer.register_texture("./res/planets/earth_material.png"),
 		//g_Renderer.register_texture("./res/planets/earth_emission.jpg",TEXTURE_FORMAT_SRGB),
 	};
 	vector<Texture*> __MonkeyTextures = {
 		g_Renderer.register_texture("./res/physical/gold_colour.png",TEXTURE_FORMAT_SRGB),
-		g_Renderer.register_texture("./res/physical/gold_normal.png"),
+		g_Renderer.register_texture("./res/physical/gold_normal.png",TEXTURE_FORMAT_NORMAL),
 		g_Renderer.register_texture("./res/physical/gold_material.png"),
 	};
 	vector<Texture*> __CloudTexture = { g_Renderer.register_texture("./res/planets/earth_cloud.jpg") };
@@ -92,10 +92,8 @@ void PlanetFocus::update()
 	f32 __ActualDistance = m_SurfaceDistance-1.f;
 
 	// height display
-	m_TxHeightDisplay->data = "distance to cloud layer = "
-			+std::to_string((u64)(__ActualDistance*FOCUS_UNIT_TO_METERS))+'m';
-	m_TxHeightDisplay->align();
-	m_TxHeightDisplay->load_buffer();
+	m_TxHeightDisplay->print("distance to cloud layer = %" PRIu64 "m",(u64)(__ActualDistance*FOCUS_UNIT_TO_METERS));
+	m_TxHeightDisplay->update();
 
 	// earth animation
 	m_PFBatch->object[m_Earth].transform.rotate_z(FOCUS_PLANET_ROTATION);
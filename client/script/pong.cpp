@@ -35,12 +35,12 @@ Pong::Pong(Font* font,string name)
 	// textures
 	vector<Texture*> __FloorTextures = {
 		g_Renderer.register_texture("./res/pong/floor_colour.png",TEXTURE_FORMAT_SRGB),
-		g_Renderer.register_texture("./res/pong/floor_normal.png"),
+		g_Renderer.register_texture("./res/pong/floor_normal.png",TEXTURE_FORMAT_NORMAL),
 		g_Renderer.register_texture("./res/pong/floor_material.png"),
 	};
 	vector<Texture*> __PedalTextures = {
 		g_Renderer.register_texture("./res/pong/pedal_colour.png",TEXTURE_FORMAT_SRGB),
-		g_Renderer.register_texture("./res/pong/pedal_normal.png"),
+		g_Renderer.register_texture("./res/pong/pedal_normal.png",TEXTURE_FORMAT_NORMAL),
 		g_Renderer.register_texture("./res/pong/pedal_material.png"),
 	};
 
@@ -84,6 +84,13 @@ Pong::Pong(Font* font,string name)
 	m_PhysicalBatch->object[m_Player0].texel = PONG_FIELD_TEXEL*.25f;
 	m_PhysicalBatch->object[m_Player1].texel = PONG_FIELD_TEXEL*.25f;
 
+	// field never moves, so its shadows can be cached
+	m_PhysicalBatch->object[__Floor].static_caster = true;
+	m_PhysicalBatch->object[__Wall0].static_caster = true;
+	m_PhysicalBatch->object[__Wall1].static_caster = true;
+	m_PhysicalBatch->object[__Wall2].static_caster = true;
+	m_PhysicalBatch->object[__Wall3].static_caster = true;
+
 	// setup index buffer object for ball batches
 	for (u32 i=0;i<PONG_BALL_PHYSICAL_COUNT;i++)
 	{
@@ -91,8 +98,7 @@ Pong::Pong(Font* font,string name)
 		m_BallIndices[i].material = vec2((i%PONG_BALL_HALF_COUNT)*PONG_BALL_HALF_COUNT_INV,
 										 (i%PONG_BALL_PHYSICAL_COUNT)*PONG_BALL_PHYSICAL_COUNT_INV);
 	}
-	m_BallBatch->ibo.bind();
-	m_BallBatch->ibo.upload_vertices(m_BallIndices,PONG_BALL_PHYSICAL_COUNT,GL_DYNAMIC_DRAW);
+	m_BallBatch->upload_instances(m_BallIndices,PONG_BALL_PHYSICAL_COUNT);
 
 	// bulb particle buffer
 	m_BulbBatch = g_Renderer.register_deferred_particle_batch(__BulbShader);
@@ -110,8 +116,7 @@ Pong::Pong(Font* font,string name)
 	g_Renderer.upload_lighting();
 
 	// light geometry buffer
-	m_BulbBatch->ibo.bind();
-	m_BallBatch->ibo.upload_vertices(m_BallIndices,PONG_LIGHTING_POINTLIGHTS,GL_DYNAMIC_DRAW);
+	m_BulbBatch->upload_instances(m_BulbIndices,PONG_LIGHTING_POINTLIGHTS);
 
 	// setup text scoreboard
 	m_Score0 = g_Renderer.write_text(font,"",vec3(250,-25,0),15,vec4(1),
@@ -176,8 +181,7 @@ void Pong::update()
 		m_BallIndices[i].position = ctvec(__GObj.balls[j].position)*PONG_SCALE_FACTOR;
 		m_BallMomentum[i] = ctvec(__GObj.balls[j].velocity)*PONG_SCALE_FACTOR;
 	}
-	m_BallBatch->ibo.bind();
-	m_BallBatch->ibo.upload_vertices(m_BallIndices,PONG_BALL_PHYSICAL_COUNT,GL_DYNAMIC_DRAW);
+	m_BallBatch->upload_instances(m_BallIndices,PONG_BALL_PHYSICAL_COUNT);
 
 	// lighting update & bulb positions
 	for (u32 i=0;i<PONG_LIGHTING_POINTLIGHTS;i++)
@@ -187,17 +191,14 @@ void Pong::update()
 		m_BulbMomentum[i] = ctvec(__GObj.balls[i*PONG_DIST_JUMP].velocity)*PONG_SCALE_FACTOR;
 		m_Lights[i]->position = __LightPosition;
 	}
-	m_BulbBatch->ibo.bind();
-	m_BulbBatch->ibo.upload_vertices(m_BulbIndices,PONG_LIGHTING_POINTLIGHTS);
+	m_BulbBatch->upload_instances(m_BulbIndices,PONG_LIGHTING_POINTLIGHTS);
 	g_Renderer.upload_lighting();
 
 	// update scoreboard
-	m_Score0->data = "Score: "+std::to_string(__GObj.score.player1);
-	m_Score0->align();
-	m_Score0->load_buffer();
-	m_Score1->data = "Score: "+std::to_string(__GObj.score.player2);
-	m_Score1->align();
-	m_Score1->load_buffer();
+	m_Score0->print("Score: %" PRIu64,(u64)__GObj.score.player1);
+	m_Score0->update();
+	m_Score1->print("Score: %" PRIu64,(u64)__GObj.score.player2);
+	m_Score1->update();
 }
 
 
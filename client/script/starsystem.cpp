@@ -22,8 +22,7 @@ StarSystem::StarSystem()
 	Mesh __SphereMesh = Mesh("./res/sphere.obj");
 	Mesh __HaloMesh = Mesh("./res/planets/ring.obj");
 	Mesh __HaloMeshBS = Mesh("./res/planets/ring_bs.obj");
-	__HaloMesh.vertices.insert(__HaloMesh.vertices.end(),
-							   __HaloMeshBS.vertices.begin(),__HaloMeshBS.vertices.end());
+	__HaloMesh.append(__HaloMeshBS);
 
 	// setup planetary geometry
 	m_PlanetBatch = g_Renderer.register_particle_batch(m_PlanetShader);
@@ -57,11 +56,13 @@ StarSystem::StarSystem()
 
 	// setup sun geometry
 	COMM_LOG("load sun geometry and textures");
-	vector<Texture*> __SunTextures = { g_Renderer.register_texture("./res/planets/halfres/sun.jpg") };
+	vector<Texture*> __SunTextures = { g_Renderer.register_texture("./res/planets/sun.jpg") };
 	lptr<GeometryBatch> __SunBatch = g_Renderer.register_geometry_batch(m_SunShader);
-	__SunBatch->add_geometry(__SphereMesh,__SunTextures);
+	u32 __SunID = __SunBatch->add_geometry(__SphereMesh,__SunTextures);
 	__SunBatch->load();
 	m_SunShader->upload("scale",STARSYS_SUN_REFERENCE_SCALE);
+	__SunBatch->object[__SunID].transform.scale(STARSYS_SUN_REFERENCE_SCALE);
+	// the sun pipeline scales by uniform, the transform only informs culling & level of detail
 	// TODO model scaling sun: 109.32f
 
 	// register routine
@@ -81,12 +82,9 @@ void StarSystem::update()
 	m_Halos[0].scale = planets[5].scale*STARSYS_SATURN_RING_DISTFACTOR;
 	m_Halos[0].texture = *m_HaloTexture;
 
-	// planetary position update
-	m_PlanetBatch->ibo.bind();
-	m_PlanetBatch->ibo.upload_vertices(planets,8,GL_DYNAMIC_DRAW);
-	m_HaloBatch->ibo.bind();
-	m_HaloBatch->ibo.upload_vertices(m_Halos,1,GL_DYNAMIC_DRAW);
-	// TODO add an option to automate this process when per-frame update is actually needed
+	// planetary position update, distant planets are drawn with a coarser sphere
+	m_PlanetBatch->upload_instances(planets,STARSYS_PLANET_COUNT);
+	m_HaloBatch->upload_instances(m_Halos,1);
 }
 
 
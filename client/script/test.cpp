@@ -21,27 +21,27 @@ TestScene::TestScene()
 	Mesh __FloorMesh = Mesh("./res/physical/test_floor.obj");
 
 	// textures
-	vector<Texture*> __SunTexture0 = { g_Renderer.register_texture("./res/planets/halfres/sun.jpg") };
-	vector<Texture*> __SunTexture1 = { g_Renderer.register_texture("./res/planets/halfres/neptune.jpg") };
+	vector<Texture*> __SunTexture0 = { g_Renderer.register_texture("./res/planets/sun.jpg") };
+	vector<Texture*> __SunTexture1 = { g_Renderer.register_texture("./res/planets/neptune.jpg") };
 	vector<Texture*> __SunTexture2 = { g_Renderer.register_texture("./res/planets/halfres/mars.jpg") };
 	vector<Texture*> __ParquetTextures = {
 		g_Renderer.register_texture("./res/physical/paquet_colour.png",TEXTURE_FORMAT_SRGB),
-		g_Renderer.register_texture("./res/physical/paquet_normal.png"),
+		g_Renderer.register_texture("./res/physical/paquet_normal.png",TEXTURE_FORMAT_NORMAL),
 		g_Renderer.register_texture("./res/physical/paquet_material.png"),
 	};
 	vector<Texture*> __MarbleTextures = {
 		g_Renderer.register_texture("./res/physical/marble_colour.png",TEXTURE_FORMAT_SRGB),
-		g_Renderer.register_texture("./res/physical/marble_normal.png"),
+		g_Renderer.register_texture("./res/physical/marble_normal.png",TEXTURE_FORMAT_NORMAL),
 		g_Renderer.register_texture("./res/physical/marble_material.png"),
 	};
 	vector<Texture*> __GoldTextures = {
 		g_Renderer.register_texture("./res/physical/gold_colour.png",TEXTURE_FORMAT_SRGB),
-		g_Renderer.register_texture("./res/physical/gold_normal.png"),
+		g_Renderer.register_texture("./res/physical/gold_normal.png",TEXTURE_FORMAT_NORMAL),
 		g_Renderer.register_texture("./res/physical/gold_material.png"),
 	};
 	vector<Texture*> __FabricTextures = {
 		g_Renderer.register_texture("./res/physical/fabric_colour.png",TEXTURE_FORMAT_SRGB),
-		g_Renderer.register_texture("./res/physical/fabric_normal.png"),
+		g_Renderer.register_texture("./res/physical/fabric_normal.png",TEXTURE_FORMAT_NORMAL),
 		g_Renderer.register_texture("./res/physical/fabric_material.png"),
 	};
 